@@ -0,0 +1,205 @@
+#include "Analysis.hpp"
+#include <algorithm>
+
+// the single value ever stored into a pointer slot, nullptr if there is none
+static Value *StoredPointer(Value *slot)
+{
+  if (slot->kind != ValueKind::Alloc)
+    return nullptr;
+  Value *res = nullptr;
+  for (auto u : slot->users)
+  {
+    if (u->kind == ValueKind::Load)
+      continue;
+    if (u->kind != ValueKind::Store || u->ops[1] != slot || u->ops[0] == slot)
+      return nullptr;
+    if (res && res != u->ops[0])
+      return nullptr;
+    res = u->ops[0];
+  }
+  return res;
+}
+
+static Value *Underlying(Value *ptr, set<Value *> &visited)
+{
+  while (true)
+  {
+    switch (ptr->kind)
+    {
+    case ValueKind::Alloc:
+    case ValueKind::GlobalAlloc:
+    case ValueKind::FuncArg:
+      return ptr;
+    case ValueKind::GetElemPtr:
+    case ValueKind::GetPtr:
+      ptr = ptr->ops[0];
+      break;
+    case ValueKind::Load:
+    {
+      auto v = StoredPointer(ptr->ops[0]);
+      if (!v)
+        return nullptr;
+      ptr = v;
+      break;
+    }
+    case ValueKind::Phi:
+    {
+      if (!visited.insert(ptr).second)
+        return ptr;
+      Value *res = nullptr;
+      for (auto in : ptr->ops)
+      {
+        auto b = Underlying(in, visited);
+        // incoming values derived from the phi itself do not add a new object
+        if (b == ptr)
+          continue;
+        if (!b || (res && res != b))
+          return nullptr;
+        res = b;
+      }
+      return res;
+    }
+    default:
+      return nullptr;
+    }
+  }
+}
+
+Value *UnderlyingObject(Value *ptr)
+{
+  set<Value *> visited;
+  auto res = Underlying(ptr, visited);
+  return res && res->kind == ValueKind::Phi ? nullptr : res;
+}
+
+/**
+ * @brief A pointer split into a base, variable terms and a constant byte offset
+ * @details The address is base + sum of value * scale over terms + offset. An index
+ * "x + c" counts as the term x and c elements of constant offset, so a[i] and
+ * a[i + 1] share their terms and differ only in the offset.
+ */
+struct Address
+{
+  Value *base;
+  vector<std::pair<Value *, int>> terms;
+  int offset = 0;
+};
+
+static Address Decompose(Value *ptr)
+{
+  Address res;
+  while (ptr->kind == ValueKind::GetElemPtr || ptr->kind == ValueKind::GetPtr)
+  {
+    auto idx = ptr->ops[1];
+    int size = ptr->kind == ValueKind::GetElemPtr ? ptr->ty->base->size() : ptr->ops[0]->ty->base->size();
+    if (idx->kind == ValueKind::Binary && idx->op == BinaryOp::Add && idx->ops[1]->kind == ValueKind::Integer)
+    {
+      res.offset += idx->ops[1]->imm * size;
+      idx = idx->ops[0];
+    }
+    if (idx->kind == ValueKind::Integer)
+      res.offset += idx->imm * size;
+    else
+      res.terms.emplace_back(idx, size);
+    ptr = ptr->ops[0];
+  }
+  res.base = ptr;
+  std::sort(res.terms.begin(), res.terms.end());
+  return res;
+}
+
+std::optional<int> PointerDistance(Value *p, Value *q)
+{
+  auto ap = Decompose(p), aq = Decompose(q);
+  if (ap.base != aq.base || ap.terms != aq.terms)
+    return std::nullopt;
+  return ap.offset - aq.offset;
+}
+
+bool MayAlias(Value *p, int psize, Value *q, int qsize)
+{
+  // the same base and variable terms, so only the constant offsets differ
+  if (auto d = PointerDistance(p, q))
+    return *d < qsize && -*d < psize;
+  auto bp = UnderlyingObject(p), bq = UnderlyingObject(q);
+  if (!bp || !bq || bp == bq)
+    return true;
+  auto kp = bp->kind, kq = bq->kind;
+  // distinct allocs and globals never overlap
+  if (kp != ValueKind::FuncArg && kq != ValueKind::FuncArg)
+    return false;
+  // an argument points into the caller, never to the allocs of this call
+  if (kp == ValueKind::Alloc || kq == ValueKind::Alloc)
+    return false;
+  return true;
+}
+
+bool IsEscaping(Value *alloc)
+{
+  vector<Value *> work = {alloc};
+  set<Value *> visited = {alloc};
+  while (!work.empty())
+  {
+    auto v = work.back();
+    work.pop_back();
+    for (auto u : v->users)
+    {
+      switch (u->kind)
+      {
+      case ValueKind::Load:
+        break;
+      case ValueKind::Store:
+        if (u->ops[0] == v)
+          return true;
+        break;
+      case ValueKind::GetElemPtr:
+      case ValueKind::GetPtr:
+      case ValueKind::Phi:
+        if (visited.insert(u).second)
+          work.push_back(u);
+        break;
+      default:
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool IsDereferenceable(Value *ptr)
+{
+  while (ptr->kind == ValueKind::GetElemPtr)
+  {
+    auto idx = ptr->ops[1];
+    if (idx->kind != ValueKind::Integer || idx->imm < 0 || idx->imm >= ptr->ops[0]->ty->base->len)
+      return false;
+    ptr = ptr->ops[0];
+  }
+  return ptr->kind == ValueKind::Alloc || ptr->kind == ValueKind::GlobalAlloc;
+}
+
+bool MayClobber(Value *inst, Value *ptr, int size)
+{
+  switch (inst->kind)
+  {
+  case ValueKind::Store:
+    return MayAlias(inst->ops[1], inst->ops[0]->ty->size(), ptr, size);
+  case ValueKind::Call:
+    return CallMayAccess(inst, ptr, true);
+  default:
+    return false;
+  }
+}
+
+bool MayRead(Value *inst, Value *ptr, int size)
+{
+  switch (inst->kind)
+  {
+  case ValueKind::Load:
+    return MayAlias(inst->ops[0], inst->ty->size(), ptr, size);
+  case ValueKind::Call:
+    return CallMayAccess(inst, ptr, false);
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include "IR.hpp"
+#include <unordered_map>
+
+using std::unordered_map;
+
+/**
+ * @brief Dominator tree of a function
+ * @details Built with the iterative algorithm of Cooper, Harvey and Kennedy over the
+ * reverse post order. Blocks which are unreachable from the entry are not in the tree.
+ */
+class DominatorTree
+{
+  unordered_map<BasicBlock *, int> _in, _out;
+
+public:
+  vector<BasicBlock *> rpo;
+  unordered_map<BasicBlock *, BasicBlock *> idom;
+  unordered_map<BasicBlock *, vector<BasicBlock *>> children;
+
+  explicit DominatorTree(Function &f);
+  bool reachable(BasicBlock *bb) const { return _in.count(bb); }
+  bool dominates(BasicBlock *a, BasicBlock *b) const;
+  // whether the definition of def is available at the instruction use
+  bool dominates(Value *def, Value *use) const;
+  unordered_map<BasicBlock *, set<BasicBlock *>> frontier() const;
+};
+
+/**
+ * @brief Post dominator tree of a function
+ * @details The dominator tree of the reversed CFG, rooted at a virtual exit which
+ * follows every returning block. Blocks which never reach a return are not in the
+ * tree, and the blocks which return have no immediate post dominator.
+ */
+class PostDominatorTree
+{
+  unordered_map<BasicBlock *, int> _in, _out;
+
+public:
+  unordered_map<BasicBlock *, BasicBlock *> ipdom;
+  unordered_map<BasicBlock *, vector<BasicBlock *>> children;
+
+  explicit PostDominatorTree(Function &f);
+  bool reachesExit(BasicBlock *bb) const { return _in.count(bb); }
+  bool postDominates(BasicBlock *a, BasicBlock *b) const;
+  // whether every path from the instruction b to a return passes through a
+  bool postDominates(Value *a, Value *b) const;
+};
+
+/**
+ * @brief A natural loop
+ * @details blocks holds the header first and then the other blocks in reverse post
+ * order, including the blocks of nested loops.
+ */
+struct Loop
+{
+  BasicBlock *header;
+  Loop *parent = nullptr;
+  vector<Loop *> subLoops;
+  vector<BasicBlock *> blocks;
+  set<BasicBlock *> blockSet;
+
+  bool contains(BasicBlock *bb) const { return blockSet.count(bb); }
+  bool contains(Value *inst) const { return inst->isInst() && contains(inst->parent); }
+  bool isInvariant(Value *v) const { return !contains(v); }
+  int depth() const { return parent ? parent->depth() + 1 : 1; }
+  // the unique outside predecessor of the header if it jumps only to the header
+  BasicBlock *preheader() const;
+  vector<BasicBlock *> latches() const;
+  // blocks inside the loop with a successor outside
+  vector<BasicBlock *> exitingBlocks() const;
+  // blocks outside the loop with a predecessor inside
+  vector<BasicBlock *> exitBlocks() const;
+};
+
+/**
+ * @brief Natural loops found from the back edges of the dominator tree
+ * @details The CFG helpers keep the loop forest consistent with the blocks they
+ * insert, other changes to the CFG require a new LoopInfo.
+ */
+class LoopInfo
+{
+  vector<unique_ptr<Loop>> _loops;
+  Function &_f;
+
+public:
+  vector<Loop *> topLevel;
+  unordered_map<BasicBlock *, Loop *> loopOf;
+
+  LoopInfo(Function &f, DominatorTree &dt);
+  // all loops, inner loops before the loops containing them
+  vector<Loop *> postOrder() const;
+  // make sure the loop has a preheader, returns nullptr if the header is the entry
+  BasicBlock *insertPreheader(Loop *loop);
+  // insert bb into loop and all of its parents, before the block before if given
+  void addBlock(Loop *loop, BasicBlock *bb, BasicBlock *before = nullptr);
+};
+
+/**
+ * @brief A basic induction variable
+ * @details phi is a header phi which is init on entry to the loop and next = phi + step
+ * on the back edge, step being loop invariant.
+ */
+struct InductionVar
+{
+  Value *phi, *init, *next, *step;
+};
+// basic induction variables of a loop with a preheader and a single latch
+vector<InductionVar> FindInductionVars(Loop *loop);
+
+/**
+ * @brief A linear combination of loop invariant values
+ * @details The arithmetic wraps around like i32 does.
+ */
+struct LinearExpr
+{
+  int constant = 0;
+  vector<std::pair<Value *, int>> terms;
+
+  bool isConstant() const { return terms.empty(); }
+  LinearExpr &operator+=(const LinearExpr &o);
+  LinearExpr operator*(int c) const;
+};
+
+/**
+ * @brief An add recurrence {ops[0], +, ops[1], +, ...}
+ * @details The value in iteration k is the sum of ops[i] * C(k, i), a single operand
+ * is a loop invariant.
+ */
+struct AddRec
+{
+  vector<LinearExpr> ops;
+};
+
+/**
+ * @brief Scalar evolution of the integer values in loops
+ * @details Values are described as add recurrences of degree at most 3 over loop
+ * invariant coefficients, built from header phis, add, sub and multiplication or
+ * shifts by constants. Trip counts are known for loops which only exit from the
+ * header, by comparing a variable stepping by a constant against an invariant.
+ */
+class ScalarEvolution
+{
+  map<std::pair<Loop *, Value *>, unique_ptr<AddRec>> _cache;
+  set<Value *> _visiting;
+
+  unique_ptr<AddRec> compute(Value *v, Loop *loop);
+  bool splitSelf(Value *v, Value *phi, Loop *loop, AddRec &rest);
+  bool exitTest(Loop *loop, LinearExpr &start, int &step, BinaryOp &op, LinearExpr &bound);
+
+public:
+  // nullptr if v is not an add recurrence of the loop
+  const AddRec *get(Value *v, Loop *loop);
+  // how many times the body of the loop runs
+  bool constantTripCount(Loop *loop, int64_t &count);
+  // the trip count computed at the end of at, nullptr if it is unknown
+  Value *expandTripCount(Loop *loop, BasicBlock *at);
+  // the value of v once the loop exits, computed at the end of at
+  Value *expandExitValue(Value *v, Loop *loop, BasicBlock *at);
+  Value *expand(const LinearExpr &e, BasicBlock *at);
+  // the value of r in iteration k
+  Value *expand(const AddRec &r, Value *k, BasicBlock *at);
+};
+
+// alias analysis
+// the alloc or global a pointer is derived from, nullptr if it comes from an argument
+Value *UnderlyingObject(Value *ptr);
+// whether an access of size bytes at p may overlap one of qsize bytes at q, the
+// values both addresses are computed from taking the same value at both accesses
+bool MayAlias(Value *p, int psize, Value *q, int qsize);
+// p - q in bytes if both are the same base and variable indices apart by a constant
+std::optional<int> PointerDistance(Value *p, Value *q);
+// whether a local alloc has its address passed to a call
+bool IsEscaping(Value *alloc);
+// whether a load from ptr can be executed speculatively
+bool IsDereferenceable(Value *ptr);
+// whether inst may write to the memory of an access of size bytes at ptr
+bool MayClobber(Value *inst, Value *ptr, int size);
+// whether inst may read the memory of an access of size bytes at ptr
+bool MayRead(Value *inst, Value *ptr, int size);
+
+/**
+ * @brief The memory a call to a function may access, apart from the callee's locals
+ * @details Globals are tracked as whole objects, arrays passed in by the index of the
+ * parameter they arrive through. An access through a pointer of unknown origin
+ * makes the summary unknown, calls may then access anything. Summaries include
+ * those of all the callees, library functions have built-in ones.
+ */
+struct ModRef
+{
+  set<Value *> refGlobals, modGlobals;
+  set<size_t> refParams, modParams;
+  bool unknown = false;
+  // whether the function does I/O, which is a side effect beyond memory
+  bool io = false;
+
+  bool operator==(const ModRef &) const = default;
+};
+// recompute the summaries of all functions of the module, replacing the old ones
+void ComputeModRef(Module &m);
+// the summary of f, nullptr for functions created since the last ComputeModRef
+const ModRef *GetModRef(Function *f);
+// whether a call may read, or with mod write, the memory at ptr
+bool CallMayAccess(Value *call, Value *ptr, bool mod);
+
+// dependence analysis
+// an array subscript as sum of coefs[i] * the i-th induction variable plus rest
+struct Subscript
+{
+  vector<int> coefs;
+  LinearExpr rest;
+  // the size of an element of the dimension
+  int size = 0;
+};
+
+/**
+ * @brief A load or store with its address split into per-dimension subscripts
+ * @details Subscripts run from the outermost dimension in. Accesses are assumed to
+ * stay within the bounds of each dimension, as a[i][j + n] for a row of n elements
+ * is undefined in SysY as in C.
+ */
+struct AccessPattern
+{
+  Value *inst, *base;
+  bool isStore;
+  vector<Subscript> subscripts;
+
+  // the bytes the address advances by per trip of the loop of the induction variable iv
+  int stride(size_t iv, int step) const;
+};
+// the access of a load or store inside the loop nest in terms of the induction
+// variables ivs of the nest, none if the address is not linear in them
+std::optional<AccessPattern> AnalyzeAccess(Value *inst, const vector<Value *> &ivs, Loop *nest);
+
+// the possible signs of a distance between two trips
+enum Direction
+{
+  kDirLt = 1,
+  kDirEq = 2,
+  kDirGt = 4,
+  kDirAll = 7,
+};
+// with a in trip x and b in trip y touching the same memory, the possible signs of
+// y - x for each induction variable stepping by steps, none if they never do
+std::optional<vector<int>> Dependence(const AccessPattern &a, const AccessPattern &b, const vector<int> &steps);
+
+/**
+ * @brief The trip control of a loop which only exits from its header
+ * @details The header branches on cond, which compares the induction variable, its
+ * operand pos, with bound. The start, step and bound are the same in every trip
+ * of the enclosing loop, so the trips of the two loops form a rectangle.
+ */
+struct LoopControl
+{
+  InductionVar iv;
+  Value *cond, *bound;
+  size_t pos;
+  int step;
+};
+// the control of loop, with start and bound invariant in outer, none if the loop
+// leaves elsewhere than from its header or does not count by a constant step
+std::optional<LoopControl> MatchLoopControl(Loop *loop, Loop *outer);
+
+/**
+ * @brief A loop body filling an array or copying one array into another
+ * @details store writes the next element of 4 bytes on every trip, a loop invariant
+ * value for a fill and the value of load, which reads the next element of another
+ * array, for a copy. Both addresses advance by stride bytes per trip, 4 or -4.
+ */
+struct MemoryIdiom
+{
+  Value *store, *load;
+  int stride;
+};
+// the fill or copy made up of insts, instructions of the body of loop whose
+// induction variable iv steps by step, none if they do anything else
+std::optional<MemoryIdiom> MatchMemoryIdiom(const vector<Value *> &insts, Loop *loop, Value *iv, int step);
+
+/**
+ * @brief A loop whose body is just another loop
+ * @details Besides its control the outer loop only computes values without side
+ * effects for the inner one, those are in outerOnly. The other header phis of both
+ * loops are sums carried through the nest. The subscripts of the accesses are in
+ * terms of ivs, the induction variables of the two loops and then of the loops
+ * inside the inner one.
+ */
+struct PerfectNest
+{
+  Loop *outer, *inner;
+  LoopControl oc, ic;
+  vector<Value *> outerOnly;
+  vector<Value *> ivs;
+  vector<int> steps;
+  vector<AccessPattern> accesses;
+};
+// the nest of outer and its only sub loop, none if it is not perfect or holds a call
+// or an access the dependence analysis cannot follow
+std::optional<PerfectNest> MatchPerfectNest(LoopInfo &li, Loop *outer);
+// whether no dependence of the nest goes forward in one of its loops and backward in
+// the other, so that running the trips of the inner loop first keeps all of them
+bool IsInterchangeLegal(const PerfectNest &nest);
@@ -0,0 +1,99 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+typedef set<std::pair<Function *, size_t>> Visited;
+
+static bool MayWriteThrough(Value *ptr, Visited &visited);
+
+// whether the callee may write to the memory its parameter i points to
+static bool MayWriteParam(Function *f, size_t i, Visited &visited)
+{
+  // of the library functions only putarray takes an array without writing it
+  if (f->isDecl())
+    return f->name != "@putarray";
+  if (!visited.insert({f, i}).second)
+    return false;
+  return MayWriteThrough(f->params[i], visited);
+}
+
+// whether memory may be written through ptr or a pointer derived from it
+static bool MayWriteThrough(Value *ptr, Visited &visited)
+{
+  vector<Value *> work = {ptr};
+  set<Value *> seen = {ptr};
+  for (size_t k = 0; k < work.size(); ++k)
+    for (auto u : work[k]->users)
+      switch (u->kind)
+      {
+      case ValueKind::Load:
+        break;
+      case ValueKind::GetElemPtr:
+      case ValueKind::GetPtr:
+      case ValueKind::Phi:
+        if (seen.insert(u).second)
+          work.push_back(u);
+        break;
+      case ValueKind::Call:
+        for (size_t i = 0; i < u->ops.size(); ++i)
+          if (u->ops[i] == work[k] && MayWriteParam(u->callee, i, visited))
+            return true;
+        break;
+      default:
+        return true;
+      }
+  return false;
+}
+
+// the element of the initializer at a byte offset into an object of type ty
+static int InitialValue(Value *init, const Type *ty, int offset)
+{
+  while (init->kind == ValueKind::Aggregate)
+  {
+    int size = ty->base->size();
+    init = init->ops[offset / size];
+    ty = ty->base;
+    offset %= size;
+  }
+  return init->kind == ValueKind::Integer ? init->imm : 0;
+}
+
+/**
+ * @brief Constant globals
+ * @details A global which is never written after its initialization, not even by a
+ * callee it is passed to, holds its initial value for the whole run. Loads of it at
+ * a constant offset are replaced by the element of the initializer. The data of the
+ * global stays where it is, as Koopa has no read-only globals, but once no dynamic
+ * load is left GlobalDCE removes it.
+ */
+bool ConstantGlobals(Module &m)
+{
+  bool changed = false;
+  for (auto g : m.globals)
+  {
+    Visited visited;
+    if (MayWriteThrough(g, visited))
+      continue;
+    auto ty = g->ty->base;
+    vector<Value *> work = {g};
+    for (size_t k = 0; k < work.size(); ++k)
+      for (auto u : vector<Value *>(work[k]->users))
+      {
+        if (u->kind == ValueKind::GetElemPtr || u->kind == ValueKind::GetPtr || u->kind == ValueKind::Phi)
+        {
+          if (std::find(work.begin(), work.end(), u) == work.end())
+            work.push_back(u);
+          continue;
+        }
+        if (u->kind != ValueKind::Load || !u->ty->isInt())
+          continue;
+        auto offset = PointerDistance(u->ops[0], g);
+        if (!offset || *offset < 0 || *offset % 4 || *offset + 4 > ty->size())
+          continue;
+        u->replaceAllUsesWith(m.getInt(InitialValue(g->ops[0], ty, *offset)));
+        u->parent->erase(u);
+        changed = true;
+      }
+  }
+  return changed;
+}
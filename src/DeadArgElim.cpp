@@ -0,0 +1,66 @@
+#include "Pass.hpp"
+#include <algorithm>
+
+// whether the parameter at index i is only passed on to f itself at the same position
+static bool IsDeadParam(Function &f, size_t i)
+{
+  auto p = f.params[i];
+  return std::all_of(p->users.begin(), p->users.end(), [&](Value *u)
+                     { return u->kind == ValueKind::Call && u->callee == &f &&
+                              std::count(u->ops.begin(), u->ops.end(), p) == 1 && u->ops[i] == p; });
+}
+
+/**
+ * @brief Dead argument and dead return value elimination
+ * @details Parameters which are never used, or only passed along unchanged by
+ * recursive calls, are removed from the function and from all calls to it. A
+ * function none of whose calls uses the result stops returning one. main keeps
+ * its signature, and declarations are left alone as the library implements them.
+ */
+bool DeadArgElim(Module &m)
+{
+  map<Function *, vector<Value *>> calls;
+  for (auto &f : m.funcs)
+    for (auto bb : f->blocks)
+      for (auto inst : bb->insts)
+        if (inst->kind == ValueKind::Call)
+          calls[inst->callee].push_back(inst);
+
+  bool changed = false;
+  // results go first, a parameter may only be used to compute the result
+  for (auto &f : m.funcs)
+  {
+    auto &sites = calls[f.get()];
+    if (f->isDecl() || f->name == "@main" || f->retTy->isUnit() ||
+        std::any_of(sites.begin(), sites.end(), [](Value *call)
+                    { return !call->users.empty(); }))
+      continue;
+    f->retTy = Type::getUnit();
+    for (auto call : sites)
+      call->ty = Type::getUnit();
+    for (auto bb : f->blocks)
+    {
+      auto ret = bb->terminator();
+      if (ret && ret->kind == ValueKind::Ret && !ret->ops.empty())
+        ret->removeOperand(0);
+    }
+    DeadCodeElim(*f);
+    changed = true;
+  }
+  for (auto &f : m.funcs)
+  {
+    if (f->isDecl() || f->name == "@main")
+      continue;
+    for (size_t i = f->params.size(); i-- > 0;)
+    {
+      if (!IsDeadParam(*f, i))
+        continue;
+      for (auto call : calls[f.get()])
+        call->removeOperand(i);
+      f->params.erase(f->params.begin() + i);
+      f->paramTys.erase(f->paramTys.begin() + i);
+      changed = true;
+    }
+  }
+  return changed;
+}
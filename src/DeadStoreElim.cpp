@@ -0,0 +1,150 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// the search for a read gives up after this many blocks
+static const int kMaxSearchBlocks = 256;
+// partial overwrites are only tracked byte by byte for stores up to this size
+static const int kMaxCoverBytes = 4096;
+
+// whether the store to q of qsize bytes writes every byte of one to p of psize bytes
+static bool Covers(Value *q, int qsize, Value *p, int psize)
+{
+  auto d = PointerDistance(p, q);
+  return d && *d >= 0 && *d + psize <= qsize;
+}
+
+// the blocks computing the address, running them again may change it
+static void AddressBlocks(Value *ptr, set<BasicBlock *> &blocks)
+{
+  while (ptr->kind == ValueKind::GetElemPtr || ptr->kind == ValueKind::GetPtr)
+  {
+    blocks.insert(ptr->parent);
+    auto idx = ptr->ops[1];
+    if (idx->isInst())
+      blocks.insert(idx->parent);
+    if (idx->kind == ValueKind::Binary && idx->ops[0]->isInst())
+      blocks.insert(idx->ops[0]->parent);
+    ptr = ptr->ops[0];
+  }
+  if (ptr->isInst())
+    blocks.insert(ptr->parent);
+}
+
+/**
+ * @brief Whether the memory written by a store may be read afterwards
+ * @details Follows every path from the store until the bytes are overwritten, by one
+ * store or by several in the block of the store, or until a return, which reads the
+ * memory unless it is a local alloc. The alias analysis compares addresses at the
+ * same values of their indices, so the search gives up where the address of the
+ * store would be computed anew.
+ */
+static bool MayBeRead(Value *store)
+{
+  auto ptr = store->ops[1];
+  int size = store->ops[0]->ty->size();
+  auto obj = UnderlyingObject(ptr);
+  bool local = obj && obj->kind == ValueKind::Alloc;
+  set<BasicBlock *> recomputed;
+  AddressBlocks(ptr, recomputed);
+
+  // 1 if inst reads the memory, 0 if it overwrites it, -1 if it does neither
+  auto visit = [&](Value *inst)
+  {
+    if (MayRead(inst, ptr, size))
+      return 1;
+    if (inst == store || (inst->kind == ValueKind::Store && Covers(inst->ops[1], inst->ops[0]->ty->size(), ptr, size)))
+      return 0;
+    if (inst->kind == ValueKind::Ret)
+      return local ? 0 : 1;
+    return -1;
+  };
+
+  // the rest of the block of the store, where partial overwrites add up
+  auto bb = store->parent;
+  vector<bool> covered(size <= kMaxCoverBytes ? size : 0);
+  int left = size;
+  for (auto it = std::next(bb->find(store)); it != bb->insts.end(); ++it)
+  {
+    auto inst = *it;
+    int r = visit(inst);
+    if (r >= 0)
+      return r == 1;
+    if (inst->kind != ValueKind::Store || covered.empty())
+      continue;
+    auto d = PointerDistance(inst->ops[1], ptr);
+    if (!d)
+      continue;
+    for (int i = std::max(*d, 0); i < std::min(*d + inst->ops[0]->ty->size(), size); ++i)
+      if (!covered[i])
+      {
+        covered[i] = true;
+        --left;
+      }
+    if (left == 0)
+      return false;
+  }
+
+  vector<BasicBlock *> work = bb->successors();
+  set<BasicBlock *> visited(work.begin(), work.end());
+  while (!work.empty())
+  {
+    auto b = work.back();
+    work.pop_back();
+    if (recomputed.count(b) || int(visited.size()) > kMaxSearchBlocks)
+      return true;
+    bool done = false;
+    for (auto inst : b->insts)
+    {
+      int r = visit(inst);
+      if (r == 1)
+        return true;
+      if (r == 0)
+      {
+        done = true;
+        break;
+      }
+    }
+    if (done)
+      continue;
+    for (auto s : b->successors())
+      if (visited.insert(s).second)
+        work.push_back(s);
+  }
+  return false;
+}
+
+/**
+ * @brief Dead store elimination
+ * @details A store is removed if no path from it reads the memory before it is
+ * overwritten or, for a local alloc, before the function returns. Stores to other
+ * memory are only examined if a store covering them post dominates them, which is
+ * cheap to check and rules out most of them.
+ */
+bool DeadStoreElim(Function &f)
+{
+  PostDominatorTree pdt(f);
+  vector<Value *> stores;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (inst->kind == ValueKind::Store)
+        stores.push_back(inst);
+
+  bool changed = false;
+  for (auto s : stores)
+  {
+    auto ptr = s->ops[1];
+    int size = s->ops[0]->ty->size();
+    auto obj = UnderlyingObject(ptr);
+    if (!(obj && obj->kind == ValueKind::Alloc) &&
+        std::none_of(stores.begin(), stores.end(), [&](Value *k)
+                     { return k != s && k->parent && Covers(k->ops[1], k->ops[0]->ty->size(), ptr, size) &&
+                              pdt.postDominates(k, s); }))
+      continue;
+    if (MayBeRead(s))
+      continue;
+    s->parent->erase(s);
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,149 @@
+#include "Analysis.hpp"
+#include <algorithm>
+
+// v as a linear combination of the induction variables and of values defined
+// outside the nest, none if it is computed some other way inside the nest
+static std::optional<Subscript> Linearize(Value *v, const vector<Value *> &ivs, Loop *nest)
+{
+  Subscript res;
+  res.coefs.assign(ivs.size(), 0);
+  auto it = std::find(ivs.begin(), ivs.end(), v);
+  if (it != ivs.end())
+  {
+    res.coefs[it - ivs.begin()] = 1;
+    return res;
+  }
+  if (v->kind == ValueKind::Integer)
+  {
+    res.rest.constant = v->imm;
+    return res;
+  }
+  if (!nest->contains(v))
+  {
+    res.rest.terms.emplace_back(v, 1);
+    return res;
+  }
+  if (v->kind != ValueKind::Binary)
+    return std::nullopt;
+  auto scale = [&](std::optional<Subscript> s, int c) -> std::optional<Subscript>
+  {
+    if (!s)
+      return std::nullopt;
+    for (auto &k : s->coefs)
+      k = int(unsigned(k) * unsigned(c));
+    s->rest = s->rest * c;
+    return s;
+  };
+  auto l = v->ops[0], r = v->ops[1];
+  switch (v->op)
+  {
+  case BinaryOp::Add:
+  case BinaryOp::Sub:
+  {
+    auto a = Linearize(l, ivs, nest), b = scale(Linearize(r, ivs, nest), v->op == BinaryOp::Sub ? -1 : 1);
+    if (!a || !b)
+      return std::nullopt;
+    for (size_t i = 0; i < ivs.size(); ++i)
+      a->coefs[i] = int(unsigned(a->coefs[i]) + unsigned(b->coefs[i]));
+    a->rest += b->rest;
+    return a;
+  }
+  case BinaryOp::Mul:
+    if (r->kind == ValueKind::Integer)
+      return scale(Linearize(l, ivs, nest), r->imm);
+    if (l->kind == ValueKind::Integer)
+      return scale(Linearize(r, ivs, nest), l->imm);
+    return std::nullopt;
+  case BinaryOp::Shl:
+    if (r->kind == ValueKind::Integer && r->imm >= 0 && r->imm < 31)
+      return scale(Linearize(l, ivs, nest), 1 << r->imm);
+    return std::nullopt;
+  default:
+    return std::nullopt;
+  }
+}
+
+std::optional<AccessPattern> AnalyzeAccess(Value *inst, const vector<Value *> &ivs, Loop *nest)
+{
+  AccessPattern res;
+  res.inst = inst;
+  res.isStore = inst->kind == ValueKind::Store;
+  auto ptr = res.isStore ? inst->ops[1] : inst->ops[0];
+  while (ptr->kind == ValueKind::GetElemPtr || ptr->kind == ValueKind::GetPtr)
+  {
+    auto s = Linearize(ptr->ops[1], ivs, nest);
+    if (!s)
+      return std::nullopt;
+    s->size = ptr->kind == ValueKind::GetElemPtr ? ptr->ty->base->size() : ptr->ops[0]->ty->base->size();
+    res.subscripts.insert(res.subscripts.begin(), *s);
+    ptr = ptr->ops[0];
+  }
+  if (ptr->kind != ValueKind::Alloc && ptr->kind != ValueKind::GlobalAlloc && ptr->kind != ValueKind::FuncArg)
+    return std::nullopt;
+  res.base = ptr;
+  return res;
+}
+
+int AccessPattern::stride(size_t iv, int step) const
+{
+  int res = 0;
+  for (auto &s : subscripts)
+    res += s.coefs[iv] * s.size;
+  return res * step;
+}
+
+static bool SameTerms(const LinearExpr &a, const LinearExpr &b)
+{
+  return a.terms.size() == b.terms.size() &&
+         std::all_of(a.terms.begin(), a.terms.end(), [&](auto &t)
+                     { return std::find(b.terms.begin(), b.terms.end(), t) != b.terms.end(); });
+}
+
+std::optional<vector<int>> Dependence(const AccessPattern &a, const AccessPattern &b, const vector<int> &steps)
+{
+  vector<int> any(steps.size(), kDirAll);
+  if (a.base != b.base)
+  {
+    // distinct allocs and globals never overlap, arguments may point anywhere
+    bool distinct = a.base->kind != ValueKind::FuncArg && b.base->kind != ValueKind::FuncArg;
+    return distinct ? std::nullopt : std::optional(any);
+  }
+  if (a.subscripts.size() != b.subscripts.size())
+    return any;
+  vector<std::optional<int>> dist(steps.size());
+  for (size_t k = 0; k < a.subscripts.size(); ++k)
+  {
+    auto &sa = a.subscripts[k], &sb = b.subscripts[k];
+    if (sa.size != sb.size)
+      return any;
+    // subscripts which differ in more than the constant leave the distance open
+    if (sa.coefs != sb.coefs || !SameTerms(sa.rest, sb.rest))
+      continue;
+    int diff = sa.rest.constant - sb.rest.constant;
+    vector<size_t> used;
+    for (size_t i = 0; i < steps.size(); ++i)
+      if (sa.coefs[i])
+        used.push_back(i);
+    if (used.empty())
+    {
+      if (diff)
+        return std::nullopt;
+      continue;
+    }
+    if (used.size() > 1)
+      continue;
+    // c * (y - x) == diff for the values, which step by steps[i] per trip
+    auto i = used[0];
+    int c = sa.coefs[i];
+    if (diff % c || (diff / c) % steps[i])
+      return std::nullopt;
+    int d = diff / c / steps[i];
+    if (dist[i] && *dist[i] != d)
+      return std::nullopt;
+    dist[i] = d;
+  }
+  for (size_t i = 0; i < steps.size(); ++i)
+    if (dist[i])
+      any[i] = *dist[i] < 0 ? kDirLt : *dist[i] > 0 ? kDirGt : kDirEq;
+  return any;
+}
@@ -0,0 +1,238 @@
+#include "Analysis.hpp"
+#include <algorithm>
+#include <cassert>
+
+DominatorTree::DominatorTree(Function &f)
+{
+  f.buildCFG();
+  rpo = ReversePostOrder(f);
+  unordered_map<BasicBlock *, int> order;
+  for (size_t i = 0; i < rpo.size(); ++i)
+    order[rpo[i]] = i;
+
+  auto entry = f.entry();
+  idom[entry] = entry;
+  auto intersect = [&](BasicBlock *a, BasicBlock *b)
+  {
+    while (a != b)
+    {
+      while (order[a] > order[b])
+        a = idom[a];
+      while (order[b] > order[a])
+        b = idom[b];
+    }
+    return a;
+  };
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); ++i)
+    {
+      auto bb = rpo[i];
+      BasicBlock *d = nullptr;
+      for (auto p : bb->preds)
+      {
+        auto it = idom.find(p);
+        if (it == idom.end() || !it->second)
+          continue;
+        d = d ? intersect(p, d) : p;
+      }
+      auto &cur = idom[bb];
+      if (cur != d)
+      {
+        cur = d;
+        changed = true;
+      }
+    }
+  }
+  for (size_t i = 1; i < rpo.size(); ++i)
+    children[idom[rpo[i]]].push_back(rpo[i]);
+
+  // number the tree in DFS order so that dominance queries take constant time
+  int clk = 0;
+  vector<std::pair<BasicBlock *, size_t>> stack = {{entry, 0}};
+  _in[entry] = clk++;
+  while (!stack.empty())
+  {
+    auto &[bb, i] = stack.back();
+    auto &ch = children[bb];
+    if (i < ch.size())
+    {
+      auto c = ch[i++];
+      _in[c] = clk++;
+      stack.push_back({c, 0});
+    }
+    else
+    {
+      _out[bb] = clk++;
+      stack.pop_back();
+    }
+  }
+}
+
+bool DominatorTree::dominates(BasicBlock *a, BasicBlock *b) const
+{
+  if (!reachable(a) || !reachable(b))
+    return false;
+  return _in.at(a) <= _in.at(b) && _out.at(b) <= _out.at(a);
+}
+
+bool DominatorTree::dominates(Value *def, Value *use) const
+{
+  if (!def->isInst())
+    return true;
+  auto a = def->parent, b = use->parent;
+  if (a != b)
+    return dominates(a, b);
+  for (auto inst : a->insts)
+  {
+    if (inst == def)
+      return true;
+    if (inst == use)
+      return false;
+  }
+  return false;
+}
+
+unordered_map<BasicBlock *, set<BasicBlock *>> DominatorTree::frontier() const
+{
+  unordered_map<BasicBlock *, set<BasicBlock *>> df;
+  for (auto bb : rpo)
+  {
+    if (bb->preds.size() < 2)
+      continue;
+    for (auto p : bb->preds)
+    {
+      if (!reachable(p))
+        continue;
+      auto runner = p;
+      while (runner != idom.at(bb))
+      {
+        df[runner].insert(bb);
+        runner = idom.at(runner);
+      }
+    }
+  }
+  return df;
+}
+
+PostDominatorTree::PostDominatorTree(Function &f)
+{
+  f.buildCFG();
+  // reverse post order of the reversed CFG, the virtual exit being nullptr
+  vector<BasicBlock *> order;
+  set<BasicBlock *> visited;
+  vector<std::pair<BasicBlock *, size_t>> stack;
+  for (auto e : f.blocks)
+  {
+    auto ret = e->terminator();
+    if (!ret || ret->kind != ValueKind::Ret || !visited.insert(e).second)
+      continue;
+    stack.push_back({e, 0});
+    while (!stack.empty())
+    {
+      auto &[bb, i] = stack.back();
+      if (i < bb->preds.size())
+      {
+        auto p = bb->preds[i++];
+        if (visited.insert(p).second)
+          stack.push_back({p, 0});
+      }
+      else
+      {
+        order.push_back(bb);
+        stack.pop_back();
+      }
+    }
+  }
+  order.push_back(nullptr);
+  std::reverse(order.begin(), order.end());
+  unordered_map<BasicBlock *, int> index;
+  for (size_t i = 0; i < order.size(); ++i)
+    index[order[i]] = i;
+
+  ipdom[nullptr] = nullptr;
+  auto intersect = [&](BasicBlock *a, BasicBlock *b)
+  {
+    while (a != b)
+    {
+      while (index[a] > index[b])
+        a = ipdom[a];
+      while (index[b] > index[a])
+        b = ipdom[b];
+    }
+    return a;
+  };
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+      auto bb = order[i];
+      auto succs = bb->successors();
+      // a returning block is followed by the virtual exit
+      BasicBlock *d = nullptr;
+      bool found = succs.empty();
+      for (auto s : succs)
+      {
+        if (!ipdom.count(s))
+          continue;
+        d = found ? intersect(s, d) : s;
+        found = true;
+      }
+      auto it = ipdom.find(bb);
+      if (it == ipdom.end() || it->second != d)
+      {
+        ipdom[bb] = d;
+        changed = true;
+      }
+    }
+  }
+  for (size_t i = 1; i < order.size(); ++i)
+    children[ipdom[order[i]]].push_back(order[i]);
+
+  int clk = 0;
+  vector<std::pair<BasicBlock *, size_t>> walk = {{nullptr, 0}};
+  _in[nullptr] = clk++;
+  while (!walk.empty())
+  {
+    auto &[bb, i] = walk.back();
+    auto &ch = children[bb];
+    if (i < ch.size())
+    {
+      auto c = ch[i++];
+      _in[c] = clk++;
+      walk.push_back({c, 0});
+    }
+    else
+    {
+      _out[bb] = clk++;
+      walk.pop_back();
+    }
+  }
+  _in.erase(nullptr);
+  ipdom.erase(nullptr);
+}
+
+bool PostDominatorTree::postDominates(BasicBlock *a, BasicBlock *b) const
+{
+  if (!reachesExit(a) || !reachesExit(b))
+    return false;
+  return _in.at(a) <= _in.at(b) && _out.at(b) <= _out.at(a);
+}
+
+bool PostDominatorTree::postDominates(Value *a, Value *b) const
+{
+  if (a->parent != b->parent)
+    return postDominates(a->parent, b->parent);
+  for (auto inst : a->parent->insts)
+  {
+    if (inst == b)
+      return true;
+    if (inst == a)
+      return false;
+  }
+  return false;
+}
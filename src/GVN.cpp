@@ -0,0 +1,136 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <cstdint>
+
+typedef vector<uintptr_t> Key;
+
+// the hash key of an expression, empty if the instruction can not be numbered
+static Key MakeKey(Value *inst)
+{
+  auto id = [](Value *v) -> uintptr_t
+  {
+    // constants are not unique objects, number them by value
+    return v->kind == ValueKind::Integer ? (uintptr_t)(uint32_t)v->imm * 2 + 1 : (uintptr_t)v;
+  };
+  switch (inst->kind)
+  {
+  case ValueKind::Binary:
+  {
+    auto l = id(inst->ops[0]), r = id(inst->ops[1]);
+    if (IsCommutative(inst->op) && l > r)
+      std::swap(l, r);
+    return {(uintptr_t)inst->kind, (uintptr_t)inst->op, l, r};
+  }
+  case ValueKind::GetElemPtr:
+  case ValueKind::GetPtr:
+    return {(uintptr_t)inst->kind, id(inst->ops[0]), id(inst->ops[1])};
+  case ValueKind::Phi:
+  {
+    Key k = {(uintptr_t)inst->kind, (uintptr_t)inst->parent};
+    vector<std::pair<uintptr_t, uintptr_t>> in;
+    for (size_t i = 0; i < inst->ops.size(); ++i)
+      in.push_back({(uintptr_t)inst->blocks[i], id(inst->ops[i])});
+    std::sort(in.begin(), in.end());
+    for (auto &[b, v] : in)
+      k.insert(k.end(), {b, v});
+    return k;
+  }
+  default:
+    return {};
+  }
+}
+
+// replace inst if it computes a constant or merges a single value
+static Value *Simplify(Module &m, Value *inst)
+{
+  if (inst->kind == ValueKind::Binary)
+  {
+    auto l = inst->ops[0], r = inst->ops[1];
+    if (l->kind == ValueKind::Integer && r->kind == ValueKind::Integer)
+      if (auto v = FoldBinary(inst->op, l->imm, r->imm))
+        return m.getInt(*v);
+  }
+  else if (inst->kind == ValueKind::Phi)
+  {
+    Value *same = nullptr;
+    for (auto v : inst->ops)
+    {
+      if (v == inst || v == same)
+        continue;
+      if (same)
+        return nullptr;
+      same = v;
+    }
+    return same;
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Dominator based global value numbering
+ * @details Walks the dominator tree with a scoped hash table of available
+ * expressions. An instruction whose key is already in the table is computed by a
+ * dominating instruction and is replaced by it.
+ */
+bool GVN(Function &f)
+{
+  auto &m = *f.parent;
+  DominatorTree dt(f);
+  map<Key, Value *> table;
+  bool changed = false;
+
+  struct Frame
+  {
+    BasicBlock *bb;
+    vector<Key> added;
+    size_t child;
+  };
+  vector<Frame> stack;
+  auto enter = [&](BasicBlock *bb)
+  {
+    stack.push_back({bb, {}, 0});
+    auto &added = stack.back().added;
+    for (auto it = bb->insts.begin(); it != bb->insts.end();)
+    {
+      auto inst = *it++;
+      if (auto v = Simplify(m, inst))
+      {
+        inst->replaceAllUsesWith(v);
+        bb->erase(inst);
+        changed = true;
+        continue;
+      }
+      auto key = MakeKey(inst);
+      if (key.empty())
+        continue;
+      auto found = table.find(key);
+      if (found != table.end())
+      {
+        inst->replaceAllUsesWith(found->second);
+        bb->erase(inst);
+        changed = true;
+        continue;
+      }
+      table[key] = inst;
+      added.push_back(key);
+    }
+  };
+  enter(f.entry());
+  while (!stack.empty())
+  {
+    auto &top = stack.back();
+    auto &ch = dt.children[top.bb];
+    if (top.child < ch.size())
+    {
+      enter(ch[top.child++]);
+    }
+    else
+    {
+      for (auto &k : top.added)
+        table.erase(k);
+      stack.pop_back();
+    }
+  }
+  return changed;
+}
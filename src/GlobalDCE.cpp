@@ -0,0 +1,82 @@
+#include "Pass.hpp"
+#include <algorithm>
+
+// whether the memory of a global is read anywhere, directly or through a pointer
+// derived from it, a call receiving the pointer counts as a read
+static bool IsRead(Value *global)
+{
+  vector<Value *> work = {global};
+  for (size_t i = 0; i < work.size(); ++i)
+    for (auto u : work[i]->users)
+    {
+      if (u->kind == ValueKind::GetElemPtr || u->kind == ValueKind::GetPtr)
+        work.push_back(u);
+      else if (!(u->kind == ValueKind::Store && u->ops[1] == work[i]))
+        return true;
+    }
+  return false;
+}
+
+/**
+ * @brief Whole program dead function and dead global elimination
+ * @details Functions not reachable from main over the call graph are removed, and
+ * so are globals which are never read by the remaining code, together with the
+ * stores to them. Library declarations are kept.
+ */
+bool GlobalDCE(Module &m)
+{
+  auto main = m.getFunction("@main");
+  if (!main)
+    return false;
+  set<Function *> live = {main};
+  vector<Function *> work = {main};
+  while (!work.empty())
+  {
+    auto f = work.back();
+    work.pop_back();
+    for (auto bb : f->blocks)
+      for (auto inst : bb->insts)
+        if (inst->kind == ValueKind::Call && live.insert(inst->callee).second)
+          work.push_back(inst->callee);
+  }
+
+  bool changed = false;
+  for (auto it = m.funcs.begin(); it != m.funcs.end();)
+  {
+    auto f = it->get();
+    if (f->isDecl() || live.count(f))
+    {
+      ++it;
+      continue;
+    }
+    for (auto bb : vector<BasicBlock *>(f->blocks.begin(), f->blocks.end()))
+      f->removeBlock(bb);
+    it = m.funcs.erase(it);
+    changed = true;
+  }
+
+  for (auto it = m.globals.begin(); it != m.globals.end();)
+  {
+    auto g = *it;
+    if (IsRead(g))
+    {
+      ++it;
+      continue;
+    }
+    // the stores go first, then the addresses they used
+    vector<Value *> addrs = {g};
+    for (size_t i = 0; i < addrs.size(); ++i)
+      for (auto u : vector<Value *>(addrs[i]->users))
+        if (u->kind == ValueKind::Store)
+          u->parent->erase(u);
+        else
+          addrs.push_back(u);
+    for (auto a = addrs.rbegin(); a != addrs.rend(); ++a)
+      if ((*a)->parent)
+        (*a)->parent->erase(*a);
+    g->dropOperands();
+    it = m.globals.erase(it);
+    changed = true;
+  }
+  return changed;
+}
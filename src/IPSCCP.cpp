@@ -0,0 +1,229 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+
+/**
+ * @brief The lattice of sparse conditional constant propagation
+ * @details A value is unknown until something flows into it, then a constant, and
+ * overdefined once two different values may reach it.
+ */
+struct Lattice
+{
+  enum State
+  {
+    Unknown,
+    Constant,
+    Overdefined
+  } state = Unknown;
+  int c = 0;
+
+  static Lattice constant(int c) { return {Constant, c}; }
+  static Lattice overdefined() { return {Overdefined, 0}; }
+
+  // meet with v, whether this changed
+  bool merge(Lattice v)
+  {
+    if (state == Overdefined || v.state == Unknown || (state == Constant && v.state == Constant && c == v.c))
+      return false;
+    *this = state == Unknown ? v : overdefined();
+    return true;
+  }
+};
+
+/**
+ * @brief Interprocedural sparse conditional constant propagation
+ * @details Starts from main and only follows the edges and calls which may execute.
+ * The parameters of a function meet the arguments of every executable call, the
+ * calls meet every executable return of their callee.
+ */
+class Solver
+{
+  Module &_m;
+  unordered_map<Value *, Lattice> _vals;
+  unordered_map<Function *, Lattice> _rets;
+  unordered_map<Function *, vector<Value *>> _calls;
+  set<BasicBlock *> _live;
+  set<std::pair<BasicBlock *, BasicBlock *>> _edges;
+  vector<BasicBlock *> _blockWork;
+  vector<Value *> _instWork;
+
+public:
+  explicit Solver(Module &m) : _m(m)
+  {
+    for (auto &f : m.funcs)
+      for (auto bb : f->blocks)
+        for (auto inst : bb->insts)
+          if (inst->kind == ValueKind::Call)
+            _calls[inst->callee].push_back(inst);
+  }
+
+  bool isLive(BasicBlock *bb) const { return _live.count(bb); }
+
+  Lattice get(Value *v)
+  {
+    if (v->kind == ValueKind::Integer)
+      return Lattice::constant(v->imm);
+    if (v->kind == ValueKind::FuncArg || (v->isInst() && v->ty->isInt()))
+      return _vals[v];
+    // undef is left alone, the backend reads it as 0
+    return Lattice::overdefined();
+  }
+
+  void markBlock(BasicBlock *bb)
+  {
+    if (_live.insert(bb).second)
+      _blockWork.push_back(bb);
+  }
+
+  void solve()
+  {
+    while (!_blockWork.empty() || !_instWork.empty())
+    {
+      if (!_blockWork.empty())
+      {
+        auto bb = _blockWork.back();
+        _blockWork.pop_back();
+        for (auto inst : bb->insts)
+          visit(inst);
+        continue;
+      }
+      auto inst = _instWork.back();
+      _instWork.pop_back();
+      if (inst->parent && isLive(inst->parent))
+        visit(inst);
+    }
+  }
+
+private:
+  void update(Value *v, Lattice l)
+  {
+    if (!_vals[v].merge(l))
+      return;
+    _instWork.insert(_instWork.end(), v->users.begin(), v->users.end());
+  }
+
+  void markEdge(BasicBlock *from, BasicBlock *to)
+  {
+    if (!_edges.insert({from, to}).second)
+      return;
+    if (isLive(to))
+      for (auto phi : Phis(to))
+        _instWork.push_back(phi);
+    markBlock(to);
+  }
+
+  void visit(Value *inst)
+  {
+    auto bb = inst->parent;
+    switch (inst->kind)
+    {
+    case ValueKind::Phi:
+    {
+      Lattice l;
+      for (size_t i = 0; i < inst->ops.size(); ++i)
+        if (_edges.count({inst->blocks[i], bb}))
+          l.merge(get(inst->ops[i]));
+      update(inst, l);
+      break;
+    }
+    case ValueKind::Binary:
+    {
+      auto l = get(inst->ops[0]), r = get(inst->ops[1]);
+      if (l.state == Lattice::Overdefined || r.state == Lattice::Overdefined)
+        update(inst, Lattice::overdefined());
+      else if (l.state == Lattice::Constant && r.state == Lattice::Constant)
+      {
+        auto v = FoldBinary(inst->op, l.c, r.c);
+        update(inst, v ? Lattice::constant(*v) : Lattice::overdefined());
+      }
+      break;
+    }
+    case ValueKind::Branch:
+    {
+      auto cond = get(inst->ops[0]);
+      if (cond.state == Lattice::Unknown)
+        break;
+      if (cond.state == Lattice::Overdefined || cond.c)
+        markEdge(bb, inst->blocks[0]);
+      if (cond.state == Lattice::Overdefined || !cond.c)
+        markEdge(bb, inst->blocks[1]);
+      break;
+    }
+    case ValueKind::Jump:
+      markEdge(bb, inst->blocks[0]);
+      break;
+    case ValueKind::Call:
+    {
+      auto callee = inst->callee;
+      if (callee->isDecl())
+      {
+        update(inst, Lattice::overdefined());
+        break;
+      }
+      for (size_t i = 0; i < callee->params.size(); ++i)
+        update(callee->params[i], get(inst->ops[i]));
+      markBlock(callee->entry());
+      if (inst->ty->isInt())
+        update(inst, _rets[callee]);
+      break;
+    }
+    case ValueKind::Ret:
+    {
+      auto f = bb->parent;
+      if (!inst->ops.empty() && _rets[f].merge(get(inst->ops[0])))
+        _instWork.insert(_instWork.end(), _calls[f].begin(), _calls[f].end());
+      break;
+    }
+    default:
+      if (inst->ty->isInt())
+        update(inst, Lattice::overdefined());
+      break;
+    }
+  }
+};
+
+/**
+ * @brief Interprocedural sparse conditional constant propagation
+ * @details Values found to be constant are replaced, in the functions reachable from
+ * main. This covers parameters all executable calls agree on and calls whose
+ * callee always returns the same constant. Branches on constants are left for
+ * SimplifyCFG to fold.
+ */
+bool IPSCCP(Module &m)
+{
+  auto main = m.getFunction("@main");
+  if (!main || main->isDecl())
+    return false;
+  Solver solver(m);
+  solver.markBlock(main->entry());
+  solver.solve();
+
+  bool changed = false;
+  auto replace = [&](Value *v)
+  {
+    auto l = solver.get(v);
+    if (l.state != Lattice::Constant || v->users.empty())
+      return false;
+    v->replaceAllUsesWith(m.getInt(l.c));
+    changed = true;
+    return true;
+  };
+  for (auto &f : m.funcs)
+  {
+    if (f->isDecl() || !solver.isLive(f->entry()))
+      continue;
+    for (auto p : f->params)
+      replace(p);
+    for (auto bb : f->blocks)
+    {
+      if (!solver.isLive(bb))
+        continue;
+      for (auto it = bb->insts.begin(); it != bb->insts.end();)
+      {
+        auto inst = *it++;
+        if (replace(inst) && !inst->hasSideEffect())
+          bb->erase(inst);
+      }
+    }
+  }
+  return changed;
+}
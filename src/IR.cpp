@@ -0,0 +1,1164 @@
+#include "IR.hpp"
+#include <fmt/core.h>
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+
+using fmt::format;
+using std::logic_error;
+using std::make_unique;
+
+const Type *Type::getInt32()
+{
+  static const Type t{TypeTag::Int32};
+  return &t;
+}
+
+const Type *Type::getUnit()
+{
+  static const Type t{TypeTag::Unit};
+  return &t;
+}
+
+const Type *Type::getArray(const Type *base, int len)
+{
+  static map<std::pair<const Type *, int>, unique_ptr<Type>> pool;
+  auto &p = pool[{base, len}];
+  if (!p)
+    p.reset(new Type{TypeTag::Array, base, len});
+  return p.get();
+}
+
+const Type *Type::getPointer(const Type *base)
+{
+  static map<const Type *, unique_ptr<Type>> pool;
+  auto &p = pool[base];
+  if (!p)
+    p.reset(new Type{TypeTag::Pointer, base});
+  return p.get();
+}
+
+int Type::size() const
+{
+  switch (tag)
+  {
+  case TypeTag::Int32:
+  case TypeTag::Pointer:
+    return 4;
+  case TypeTag::Array:
+    return base->size() * len;
+  default:
+    return 0;
+  }
+}
+
+string Type::dump() const
+{
+  switch (tag)
+  {
+  case TypeTag::Int32:
+    return "i32";
+  case TypeTag::Array:
+    return format("[{}, {}]", base->dump(), len);
+  case TypeTag::Pointer:
+    return format("*{}", base->dump());
+  default:
+    return "";
+  }
+}
+
+static void RemoveUser(Value *v, Value *user)
+{
+  if (v->isConstant())
+    return;
+  auto it = std::find(v->users.begin(), v->users.end(), user);
+  assert(it != v->users.end());
+  v->users.erase(it);
+}
+
+static void AddUser(Value *v, Value *user)
+{
+  if (!v->isConstant())
+    v->users.push_back(user);
+}
+
+void Value::addOperand(Value *v)
+{
+  ops.push_back(v);
+  AddUser(v, this);
+}
+
+void Value::setOperand(size_t i, Value *v)
+{
+  RemoveUser(ops[i], this);
+  ops[i] = v;
+  AddUser(v, this);
+}
+
+void Value::removeOperand(size_t i)
+{
+  RemoveUser(ops[i], this);
+  ops.erase(ops.begin() + i);
+}
+
+void Value::dropOperands()
+{
+  for (auto v : ops)
+    RemoveUser(v, this);
+  ops.clear();
+}
+
+void Value::replaceAllUsesWith(Value *v)
+{
+  assert(v != this);
+  auto us = users;
+  std::sort(us.begin(), us.end());
+  us.erase(std::unique(us.begin(), us.end()), us.end());
+  for (auto u : us)
+    for (size_t i = 0; i < u->ops.size(); ++i)
+      if (u->ops[i] == this)
+        u->setOperand(i, v);
+}
+
+vector<BasicBlock *> BasicBlock::successors() const
+{
+  vector<BasicBlock *> res;
+  auto t = terminator();
+  if (!t)
+    return res;
+  for (auto bb : t->blocks)
+    if (std::find(res.begin(), res.end(), bb) == res.end())
+      res.push_back(bb);
+  return res;
+}
+
+list<Value *>::iterator BasicBlock::find(Value *inst)
+{
+  return std::find(insts.begin(), insts.end(), inst);
+}
+
+void BasicBlock::push_back(Value *inst)
+{
+  inst->parent = this;
+  insts.push_back(inst);
+}
+
+void BasicBlock::insertBeforeTerminator(Value *inst)
+{
+  inst->parent = this;
+  if (terminator())
+    insts.insert(std::prev(insts.end()), inst);
+  else
+    insts.push_back(inst);
+}
+
+void BasicBlock::insertBefore(Value *pos, Value *inst)
+{
+  inst->parent = this;
+  insts.insert(find(pos), inst);
+}
+
+void BasicBlock::insertAfter(Value *pos, Value *inst)
+{
+  inst->parent = this;
+  insts.insert(std::next(find(pos)), inst);
+}
+
+void BasicBlock::remove(Value *inst)
+{
+  auto it = find(inst);
+  assert(it != insts.end());
+  insts.erase(it);
+  inst->parent = nullptr;
+}
+
+void BasicBlock::erase(Value *inst)
+{
+  remove(inst);
+  inst->dropOperands();
+  inst->blocks.clear();
+}
+
+BasicBlock *Function::newBlock(const string &hint)
+{
+  parent->_blocks.emplace_back(make_unique<BasicBlock>());
+  auto bb = parent->_blocks.back().get();
+  bb->name = parent->uniqueLabel(hint);
+  bb->parent = this;
+  blocks.push_back(bb);
+  return bb;
+}
+
+void Function::removeBlock(BasicBlock *bb)
+{
+  for (auto inst : bb->insts)
+  {
+    inst->dropOperands();
+    inst->parent = nullptr;
+  }
+  bb->insts.clear();
+  blocks.remove(bb);
+}
+
+void Function::buildCFG()
+{
+  for (auto bb : blocks)
+    bb->preds.clear();
+  for (auto bb : blocks)
+    for (auto s : bb->successors())
+      s->preds.push_back(bb);
+}
+
+Function *Module::getFunction(const string &name) const
+{
+  for (auto &f : funcs)
+    if (f->name == name)
+      return f.get();
+  return nullptr;
+}
+
+Function *Module::newFunction(const string &name, const Type *retTy)
+{
+  funcs.emplace_back(make_unique<Function>());
+  auto f = funcs.back().get();
+  f->name = name;
+  f->retTy = retTy;
+  f->parent = this;
+  return f;
+}
+
+string Module::uniqueLabel(const string &hint)
+{
+  string name = hint;
+  for (int i = 1; _labels.count(name); ++i)
+    name = format("{}_{}", hint, i);
+  _labels.insert(name);
+  return name;
+}
+
+Value *Module::getInt(int v)
+{
+  auto &p = _ints[v];
+  if (!p)
+  {
+    p = create(ValueKind::Integer, Type::getInt32());
+    p->imm = v;
+  }
+  return p;
+}
+
+Value *Module::getUndef(const Type *ty)
+{
+  return create(ValueKind::Undef, ty);
+}
+
+Value *Module::getZeroInit(const Type *ty)
+{
+  return create(ValueKind::ZeroInit, ty);
+}
+
+Value *Module::create(ValueKind kind, const Type *ty)
+{
+  _values.emplace_back(make_unique<Value>(kind, ty));
+  return _values.back().get();
+}
+
+Value *Module::createAlloc(const Type *ty)
+{
+  return create(ValueKind::Alloc, Type::getPointer(ty));
+}
+
+Value *Module::createLoad(Value *src)
+{
+  assert(src->ty->isPointer());
+  auto v = create(ValueKind::Load, src->ty->base);
+  v->addOperand(src);
+  return v;
+}
+
+Value *Module::createStore(Value *value, Value *dest)
+{
+  auto v = create(ValueKind::Store, Type::getUnit());
+  v->addOperand(value);
+  v->addOperand(dest);
+  return v;
+}
+
+Value *Module::createGetPtr(Value *src, Value *index)
+{
+  auto v = create(ValueKind::GetPtr, src->ty);
+  v->addOperand(src);
+  v->addOperand(index);
+  return v;
+}
+
+Value *Module::createGetElemPtr(Value *src, Value *index)
+{
+  assert(src->ty->isPointer() && src->ty->base->isArray());
+  auto v = create(ValueKind::GetElemPtr, Type::getPointer(src->ty->base->base));
+  v->addOperand(src);
+  v->addOperand(index);
+  return v;
+}
+
+Value *Module::createBinary(BinaryOp op, Value *lhs, Value *rhs)
+{
+  auto v = create(ValueKind::Binary, Type::getInt32());
+  v->op = op;
+  v->addOperand(lhs);
+  v->addOperand(rhs);
+  return v;
+}
+
+Value *Module::createBranch(Value *cond, BasicBlock *t, BasicBlock *f)
+{
+  auto v = create(ValueKind::Branch, Type::getUnit());
+  v->addOperand(cond);
+  v->blocks = {t, f};
+  return v;
+}
+
+Value *Module::createJump(BasicBlock *target)
+{
+  auto v = create(ValueKind::Jump, Type::getUnit());
+  v->blocks = {target};
+  return v;
+}
+
+Value *Module::createCall(Function *callee, const vector<Value *> &args)
+{
+  auto v = create(ValueKind::Call, callee->retTy);
+  v->callee = callee;
+  for (auto a : args)
+    v->addOperand(a);
+  return v;
+}
+
+Value *Module::createRet(Value *value)
+{
+  auto v = create(ValueKind::Ret, Type::getUnit());
+  if (value)
+    v->addOperand(value);
+  return v;
+}
+
+Value *Module::createPhi(const Type *ty)
+{
+  return create(ValueKind::Phi, ty);
+}
+
+void ReplaceSuccessor(BasicBlock *bb, BasicBlock *from, BasicBlock *to)
+{
+  auto t = bb->terminator();
+  assert(t);
+  for (auto &b : t->blocks)
+    if (b == from)
+      b = to;
+}
+
+void ReplacePhiIncoming(BasicBlock *bb, BasicBlock *from, BasicBlock *to)
+{
+  for (auto phi : Phis(bb))
+    for (auto &b : phi->blocks)
+      if (b == from)
+        b = to;
+}
+
+void RemovePhiIncoming(BasicBlock *bb, BasicBlock *from)
+{
+  for (auto phi : Phis(bb))
+    for (size_t i = 0; i < phi->blocks.size(); ++i)
+      if (phi->blocks[i] == from)
+      {
+        phi->removeOperand(i);
+        phi->blocks.erase(phi->blocks.begin() + i);
+        --i;
+      }
+}
+
+vector<Value *> Phis(BasicBlock *bb)
+{
+  vector<Value *> res;
+  for (auto inst : bb->insts)
+  {
+    if (inst->kind != ValueKind::Phi)
+      break;
+    res.push_back(inst);
+  }
+  return res;
+}
+
+vector<BasicBlock *> ReversePostOrder(Function &f)
+{
+  vector<BasicBlock *> order;
+  if (f.isDecl())
+    return order;
+  set<BasicBlock *> visited;
+  // iterative DFS, each frame remembers the next successor to visit
+  vector<std::pair<BasicBlock *, size_t>> stack;
+  stack.push_back({f.entry(), 0});
+  visited.insert(f.entry());
+  while (!stack.empty())
+  {
+    auto &[bb, i] = stack.back();
+    auto succs = bb->successors();
+    if (i < succs.size())
+    {
+      auto s = succs[i++];
+      if (visited.insert(s).second)
+        stack.push_back({s, 0});
+    }
+    else
+    {
+      order.push_back(bb);
+      stack.pop_back();
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+BasicBlock *SplitBlock(BasicBlock *bb, Value *pos, const string &hint)
+{
+  auto &f = *bb->parent;
+  auto rest = f.newBlock(hint);
+  auto it = std::next(bb->find(pos));
+  rest->insts.splice(rest->insts.end(), bb->insts, it, bb->insts.end());
+  for (auto inst : rest->insts)
+    inst->parent = rest;
+  for (auto s : rest->successors())
+    ReplacePhiIncoming(s, bb, rest);
+  return rest;
+}
+
+vector<BasicBlock *> CloneBlocks(const vector<BasicBlock *> &blocks, Function &f, map<Value *, Value *> &vmap)
+{
+  auto &m = *f.parent;
+  map<BasicBlock *, BasicBlock *> bmap;
+  vector<BasicBlock *> res;
+  for (auto bb : blocks)
+  {
+    res.push_back(f.newBlock(bb->name));
+    bmap[bb] = res.back();
+  }
+  for (auto bb : blocks)
+    for (auto inst : bb->insts)
+    {
+      auto c = m.create(inst->kind, inst->ty);
+      c->name = inst->name;
+      c->imm = inst->imm;
+      c->op = inst->op;
+      c->callee = inst->callee;
+      bmap[bb]->push_back(c);
+      vmap[inst] = c;
+    }
+  // operands may refer to instructions later in the region, e.g. in phis
+  for (auto bb : blocks)
+    for (auto inst : bb->insts)
+    {
+      auto c = vmap[inst];
+      for (auto op : inst->ops)
+      {
+        auto it = vmap.find(op);
+        c->addOperand(it != vmap.end() ? it->second : op);
+      }
+      for (auto b : inst->blocks)
+        c->blocks.push_back(bmap.count(b) ? bmap[b] : b);
+    }
+  return res;
+}
+
+/* ---------------------------------- parser ---------------------------------- */
+
+namespace
+{
+  struct Token
+  {
+    enum Kind
+    {
+      Symbol,
+      Int,
+      Word,
+      Punct,
+      End
+    } kind;
+    string text;
+    int value = 0;
+  };
+
+  vector<Token> Tokenize(const string &s)
+  {
+    vector<Token> res;
+    size_t i = 0;
+    while (i < s.size())
+    {
+      char c = s[i];
+      if (isspace(c))
+      {
+        ++i;
+      }
+      else if (c == '/' && i + 1 < s.size() && s[i + 1] == '/')
+      {
+        while (i < s.size() && s[i] != '\n')
+          ++i;
+      }
+      else if (c == '/' && i + 1 < s.size() && s[i + 1] == '*')
+      {
+        auto e = s.find("*/", i + 2);
+        i = e == string::npos ? s.size() : e + 2;
+      }
+      else if (c == '@' || c == '%')
+      {
+        size_t j = i + 1;
+        while (j < s.size() && (isalnum(s[j]) || s[j] == '_'))
+          ++j;
+        res.push_back({Token::Symbol, s.substr(i, j - i)});
+        i = j;
+      }
+      else if (isdigit(c) || (c == '-' && i + 1 < s.size() && isdigit(s[i + 1])))
+      {
+        size_t j = i + 1;
+        while (j < s.size() && isdigit(s[j]))
+          ++j;
+        auto text = s.substr(i, j - i);
+        res.push_back({Token::Int, text, (int)std::stoll(text)});
+        i = j;
+      }
+      else if (isalpha(c) || c == '_')
+      {
+        size_t j = i + 1;
+        while (j < s.size() && (isalnum(s[j]) || s[j] == '_'))
+          ++j;
+        res.push_back({Token::Word, s.substr(i, j - i)});
+        i = j;
+      }
+      else
+      {
+        res.push_back({Token::Punct, string(1, c)});
+        ++i;
+      }
+    }
+    res.push_back({Token::End, ""});
+    return res;
+  }
+
+  const map<string, BinaryOp> BinaryOps = {
+      {"ne", BinaryOp::NotEq}, {"eq", BinaryOp::Eq}, {"gt", BinaryOp::Gt}, {"lt", BinaryOp::Lt}, {"ge", BinaryOp::Ge}, {"le", BinaryOp::Le}, {"add", BinaryOp::Add}, {"sub", BinaryOp::Sub}, {"mul", BinaryOp::Mul}, {"div", BinaryOp::Div}, {"mod", BinaryOp::Mod}, {"and", BinaryOp::And}, {"or", BinaryOp::Or}, {"xor", BinaryOp::Xor}, {"shl", BinaryOp::Shl}, {"shr", BinaryOp::Shr}, {"sar", BinaryOp::Sar}};
+
+  class Parser
+  {
+    vector<Token> _toks;
+    size_t _pos = 0;
+    Module &_m;
+    map<string, Value *> _globals;
+    map<string, Value *> _locals;
+    map<string, BasicBlock *> _labels;
+    Function *_func = nullptr;
+
+    const Token &peek(int k = 0) const { return _toks[std::min(_pos + k, _toks.size() - 1)]; }
+    Token next() { return _toks[_pos++]; }
+    bool accept(const string &text)
+    {
+      if (peek().kind != Token::End && peek().text == text)
+      {
+        ++_pos;
+        return true;
+      }
+      return false;
+    }
+    void expect(const string &text)
+    {
+      if (!accept(text))
+        throw logic_error(format("koopa parse error: expect '{}' but get '{}'", text, peek().text));
+    }
+    string symbol()
+    {
+      if (peek().kind != Token::Symbol)
+        throw logic_error(format("koopa parse error: expect symbol but get '{}'", peek().text));
+      return next().text;
+    }
+
+    const Type *type()
+    {
+      if (accept("i32"))
+        return Type::getInt32();
+      if (accept("*"))
+        return Type::getPointer(type());
+      if (accept("["))
+      {
+        auto base = type();
+        expect(",");
+        int len = next().value;
+        expect("]");
+        return Type::getArray(base, len);
+      }
+      throw logic_error(format("koopa parse error: unknown type '{}'", peek().text));
+    }
+
+    Value *initializer(const Type *ty)
+    {
+      if (peek().kind == Token::Int)
+        return _m.getInt(next().value);
+      if (accept("zeroinit"))
+        return _m.getZeroInit(ty);
+      if (accept("undef"))
+        return _m.getUndef(ty);
+      expect("{");
+      auto agg = _m.create(ValueKind::Aggregate, ty);
+      do
+      {
+        agg->addOperand(initializer(ty->base));
+      } while (accept(","));
+      expect("}");
+      return agg;
+    }
+
+    Value *lookup(const string &name)
+    {
+      if (_locals.count(name))
+        return _locals[name];
+      if (_globals.count(name))
+        return _globals[name];
+      throw logic_error(format("koopa parse error: undefined symbol {}", name));
+    }
+
+    Value *value()
+    {
+      if (peek().kind == Token::Int)
+        return _m.getInt(next().value);
+      if (accept("undef"))
+        return _m.getUndef(Type::getInt32());
+      return lookup(symbol());
+    }
+
+    BasicBlock *label(const string &name)
+    {
+      auto &bb = _labels[name];
+      if (!bb)
+      {
+        bb = _func->newBlock(name);
+        // every function has its own entry label
+        if (name == "%entry")
+          bb->name = name;
+      }
+      return bb;
+    }
+
+    Function *funcHeader(bool isDecl)
+    {
+      auto name = symbol();
+      auto f = _m.getFunction(name);
+      bool fresh = !f;
+      if (fresh)
+        f = _m.newFunction(name, Type::getUnit());
+      vector<std::pair<string, const Type *>> params;
+      expect("(");
+      if (!accept(")"))
+      {
+        do
+        {
+          string pname;
+          if (!isDecl)
+          {
+            pname = symbol();
+            expect(":");
+          }
+          params.push_back({pname, type()});
+        } while (accept(","));
+        expect(")");
+      }
+      if (accept(":"))
+        f->retTy = type();
+      if (fresh)
+      {
+        for (auto &[pname, ty] : params)
+        {
+          f->paramTys.push_back(ty);
+          if (!isDecl)
+          {
+            auto arg = _m.create(ValueKind::FuncArg, ty);
+            arg->name = pname;
+            f->params.push_back(arg);
+          }
+        }
+      }
+      return f;
+    }
+
+    void skipBody()
+    {
+      int depth = 0;
+      do
+      {
+        if (peek().text == "{")
+          ++depth;
+        else if (peek().text == "}")
+          --depth;
+        next();
+      } while (depth > 0);
+    }
+
+    Value *instruction(BasicBlock *bb)
+    {
+      string def;
+      if (peek().kind == Token::Symbol && peek(1).text == "=")
+      {
+        def = next().text;
+        next();
+      }
+      auto op = next().text;
+      Value *inst = nullptr;
+      if (op == "alloc")
+      {
+        inst = _m.createAlloc(type());
+      }
+      else if (op == "load")
+      {
+        inst = _m.createLoad(value());
+      }
+      else if (op == "store")
+      {
+        Value *v;
+        if (accept("zeroinit"))
+          v = _m.getZeroInit(nullptr);
+        else
+          v = value();
+        expect(",");
+        auto dest = value();
+        if (v->kind == ValueKind::ZeroInit)
+          v->ty = dest->ty->base;
+        inst = _m.createStore(v, dest);
+      }
+      else if (op == "getptr" || op == "getelemptr")
+      {
+        auto src = value();
+        expect(",");
+        auto idx = value();
+        inst = op == "getptr" ? _m.createGetPtr(src, idx) : _m.createGetElemPtr(src, idx);
+      }
+      else if (BinaryOps.count(op))
+      {
+        auto l = value();
+        expect(",");
+        auto r = value();
+        inst = _m.createBinary(BinaryOps.at(op), l, r);
+      }
+      else if (op == "br")
+      {
+        auto c = value();
+        expect(",");
+        auto t = label(symbol());
+        expect(",");
+        auto f = label(symbol());
+        inst = _m.createBranch(c, t, f);
+      }
+      else if (op == "jump")
+      {
+        inst = _m.createJump(label(symbol()));
+      }
+      else if (op == "ret")
+      {
+        Value *v = nullptr;
+        if (peek().kind == Token::Int || (peek().kind == Token::Symbol && peek(1).text != ":" && peek(1).text != "="))
+          v = value();
+        inst = _m.createRet(v);
+      }
+      else if (op == "call")
+      {
+        auto callee = _m.getFunction(symbol());
+        assert(callee);
+        vector<Value *> args;
+        expect("(");
+        if (!accept(")"))
+        {
+          do
+          {
+            args.push_back(value());
+          } while (accept(","));
+          expect(")");
+        }
+        inst = _m.createCall(callee, args);
+      }
+      else
+      {
+        throw logic_error(format("koopa parse error: unknown instruction '{}'", op));
+      }
+      if (!def.empty())
+      {
+        inst->name = def;
+        _locals[def] = inst;
+      }
+      bb->push_back(inst);
+      return inst;
+    }
+
+    void funcBody(Function *f)
+    {
+      _func = f;
+      _locals.clear();
+      _labels.clear();
+      for (auto p : f->params)
+        _locals[p->name] = p;
+      expect("{");
+      BasicBlock *bb = nullptr;
+      while (!accept("}"))
+      {
+        if (peek().kind == Token::Symbol && peek(1).text == ":")
+        {
+          bb = label(next().text);
+          next();
+          // keep the textual order of blocks
+          f->blocks.remove(bb);
+          f->blocks.push_back(bb);
+          continue;
+        }
+        assert(bb);
+        instruction(bb);
+      }
+    }
+
+  public:
+    Parser(const string &text, Module &m) : _toks(Tokenize(text)), _m(m) {}
+
+    void parse()
+    {
+      // collect function signatures first, so calls may refer to later functions
+      while (peek().kind != Token::End)
+      {
+        auto w = next().text;
+        if (w == "fun" || w == "decl")
+        {
+          funcHeader(w == "decl");
+          if (w == "fun")
+            skipBody();
+        }
+      }
+      _pos = 0;
+      while (peek().kind != Token::End)
+      {
+        auto w = next().text;
+        if (w == "global")
+        {
+          auto name = symbol();
+          expect("=");
+          expect("alloc");
+          auto ty = type();
+          expect(",");
+          auto g = _m.create(ValueKind::GlobalAlloc, Type::getPointer(ty));
+          g->name = name;
+          g->addOperand(initializer(ty));
+          _m.globals.push_back(g);
+          _globals[name] = g;
+        }
+        else if (w == "decl")
+        {
+          funcHeader(true);
+        }
+        else if (w == "fun")
+        {
+          funcBody(funcHeader(false));
+        }
+        else
+        {
+          throw logic_error(format("koopa parse error: unexpected '{}'", w));
+        }
+      }
+    }
+  };
+
+  const char *BinaryOpName(BinaryOp op)
+  {
+    for (auto &[name, o] : BinaryOps)
+      if (o == op)
+        return name.c_str();
+    return "";
+  }
+
+  class Printer
+  {
+    std::unordered_map<const Value *, string> _names;
+    set<string> _used;
+    int _cnt = 0;
+
+  public:
+    string name(const Value *v)
+    {
+      switch (v->kind)
+      {
+      case ValueKind::Integer:
+        return format("{}", v->imm);
+      case ValueKind::ZeroInit:
+        return "zeroinit";
+      case ValueKind::Undef:
+        return "undef";
+      case ValueKind::Aggregate:
+      {
+        string res = "{";
+        for (size_t i = 0; i < v->ops.size(); ++i)
+          res += (i ? ", " : "") + name(v->ops[i]);
+        return res + "}";
+      }
+      case ValueKind::GlobalAlloc:
+        return v->name;
+      default:
+        break;
+      }
+      auto it = _names.find(v);
+      if (it != _names.end())
+        return it->second;
+      string n;
+      if (!v->name.empty() && v->name[0] == '@')
+      {
+        n = v->name;
+        for (int i = 1; _used.count(n); ++i)
+          n = format("{}_{}", v->name, i);
+      }
+      else
+      {
+        do
+          n = format("%{}", _cnt++);
+        while (_used.count(n));
+      }
+      _used.insert(n);
+      _names[v] = n;
+      return n;
+    }
+
+    string inst(const Value *v)
+    {
+      auto ops = [&](size_t i)
+      { return name(v->ops[i]); };
+      string body;
+      switch (v->kind)
+      {
+      case ValueKind::Alloc:
+        body = format("alloc {}", v->ty->base->dump());
+        break;
+      case ValueKind::Load:
+        body = format("load {}", ops(0));
+        break;
+      case ValueKind::Store:
+        body = format("store {}, {}", ops(0), ops(1));
+        break;
+      case ValueKind::GetPtr:
+        body = format("getptr {}, {}", ops(0), ops(1));
+        break;
+      case ValueKind::GetElemPtr:
+        body = format("getelemptr {}, {}", ops(0), ops(1));
+        break;
+      case ValueKind::Binary:
+        body = format("{} {}, {}", BinaryOpName(v->op), ops(0), ops(1));
+        break;
+      case ValueKind::Branch:
+        body = format("br {}, {}, {}", ops(0), v->blocks[0]->name, v->blocks[1]->name);
+        break;
+      case ValueKind::Jump:
+        body = format("jump {}", v->blocks[0]->name);
+        break;
+      case ValueKind::Ret:
+        body = v->ops.empty() ? "ret" : format("ret {}", ops(0));
+        break;
+      case ValueKind::Call:
+      {
+        body = format("call {}(", v->callee->name);
+        for (size_t i = 0; i < v->ops.size(); ++i)
+          body += (i ? ", " : "") + ops(i);
+        body += ")";
+        break;
+      }
+      case ValueKind::Phi:
+      {
+        // phis are lowered before the IR is handed to libkoopa, this is only for debugging
+        body = "phi ";
+        for (size_t i = 0; i < v->ops.size(); ++i)
+          body += format("{}[{}, {}]", i ? ", " : "", ops(i), v->blocks[i]->name);
+        break;
+      }
+      default:
+        throw logic_error("unexpected value in instruction list");
+      }
+      if (v->ty->isUnit())
+        return format("\t{}\n", body);
+      return format("\t{} = {}\n", name(v), body);
+    }
+
+    string func(const Function &f, const set<string> &globals)
+    {
+      _names.clear();
+      _used = globals;
+      _cnt = 0;
+      string res;
+      if (f.isDecl())
+      {
+        res = format("decl {}(", f.name);
+        for (size_t i = 0; i < f.paramTys.size(); ++i)
+          res += (i ? ", " : "") + f.paramTys[i]->dump();
+        res += ")";
+        if (!f.retTy->isUnit())
+          res += format(": {}", f.retTy->dump());
+        return res + "\n";
+      }
+      res = format("fun {}(", f.name);
+      for (size_t i = 0; i < f.params.size(); ++i)
+        res += format("{}{}: {}", i ? ", " : "", name(f.params[i]), f.params[i]->ty->dump());
+      res += ")";
+      if (!f.retTy->isUnit())
+        res += format(": {}", f.retTy->dump());
+      res += " {\n";
+      for (auto bb : f.blocks)
+      {
+        res += format("{}:\n", bb->name);
+        for (auto v : bb->insts)
+          res += inst(v);
+      }
+      return res + "}\n";
+    }
+  };
+}
+
+unique_ptr<Module> ParseIR(const string &text)
+{
+  auto m = make_unique<Module>();
+  Parser(text, *m).parse();
+  return m;
+}
+
+string DumpIR(const Module &m)
+{
+  Printer p;
+  string res;
+  set<string> globals;
+  for (auto &f : m.funcs)
+    if (f->isDecl())
+      res += p.func(*f, globals);
+  res += "\n";
+  for (auto g : m.globals)
+  {
+    globals.insert(g->name);
+    res += format("global {} = alloc {}, {}\n", g->name, g->ty->base->dump(), p.name(g->ops[0]));
+  }
+  for (auto &f : m.funcs)
+    if (!f->isDecl())
+      res += "\n" + p.func(*f, globals);
+  return res;
+}
+
+bool IsSpeculatable(Value *inst)
+{
+  switch (inst->kind)
+  {
+  case ValueKind::Binary:
+    if (inst->op == BinaryOp::Div || inst->op == BinaryOp::Mod)
+      return inst->ops[1]->kind == ValueKind::Integer && inst->ops[1]->imm != 0;
+    return true;
+  case ValueKind::GetElemPtr:
+  case ValueKind::GetPtr:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::optional<int> FoldBinary(BinaryOp op, int l, int r)
+{
+  unsigned ul = l, ur = r;
+  switch (op)
+  {
+  case BinaryOp::NotEq:
+    return l != r;
+  case BinaryOp::Eq:
+    return l == r;
+  case BinaryOp::Gt:
+    return l > r;
+  case BinaryOp::Lt:
+    return l < r;
+  case BinaryOp::Ge:
+    return l >= r;
+  case BinaryOp::Le:
+    return l <= r;
+  case BinaryOp::Add:
+    return (int)(ul + ur);
+  case BinaryOp::Sub:
+    return (int)(ul - ur);
+  case BinaryOp::Mul:
+    return (int)(ul * ur);
+  case BinaryOp::Div:
+    if (r == 0 || (l == INT32_MIN && r == -1))
+      return std::nullopt;
+    return l / r;
+  case BinaryOp::Mod:
+    if (r == 0 || (l == INT32_MIN && r == -1))
+      return std::nullopt;
+    return l % r;
+  case BinaryOp::And:
+    return l & r;
+  case BinaryOp::Or:
+    return l | r;
+  case BinaryOp::Xor:
+    return l ^ r;
+  case BinaryOp::Shl:
+    return (int)(ul << (r & 31));
+  case BinaryOp::Shr:
+    return (int)(ul >> (r & 31));
+  case BinaryOp::Sar:
+    return l >> (r & 31);
+  }
+  return std::nullopt;
+}
+
+bool IsCommutative(BinaryOp op)
+{
+  switch (op)
+  {
+  case BinaryOp::Add:
+  case BinaryOp::Mul:
+  case BinaryOp::Eq:
+  case BinaryOp::NotEq:
+  case BinaryOp::And:
+  case BinaryOp::Or:
+  case BinaryOp::Xor:
+    return true;
+  default:
+    return false;
+  }
+}
+
+BinaryOp SwappedCompare(BinaryOp op)
+{
+  switch (op)
+  {
+  case BinaryOp::Lt:
+    return BinaryOp::Gt;
+  case BinaryOp::Gt:
+    return BinaryOp::Lt;
+  case BinaryOp::Le:
+    return BinaryOp::Ge;
+  case BinaryOp::Ge:
+    return BinaryOp::Le;
+  default:
+    return op;
+  }
+}
+
+BinaryOp NegatedCompare(BinaryOp op)
+{
+  switch (op)
+  {
+  case BinaryOp::Lt:
+    return BinaryOp::Ge;
+  case BinaryOp::Ge:
+    return BinaryOp::Lt;
+  case BinaryOp::Gt:
+    return BinaryOp::Le;
+  case BinaryOp::Le:
+    return BinaryOp::Gt;
+  case BinaryOp::Eq:
+    return BinaryOp::NotEq;
+  default:
+    return BinaryOp::Eq;
+  }
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+using std::deque;
+using std::list;
+using std::map;
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+/**
+ * @brief In-memory Koopa IR used by the optimizer
+ * @details The frontend emits Koopa IR as text. ParseIR turns that text into the
+ * mutable structures below, the passes in Pass.hpp rewrite them, and DumpIR
+ * prints them back so that libkoopa and the RISC-V backend see ordinary Koopa IR.
+ */
+
+enum class TypeTag
+{
+  Int32,
+  Unit,
+  Array,
+  Pointer
+};
+
+struct Type
+{
+  TypeTag tag;
+  const Type *base = nullptr;
+  int len = 0;
+
+  // types are interned, so they can be compared by address
+  static const Type *getInt32();
+  static const Type *getUnit();
+  static const Type *getArray(const Type *base, int len);
+  static const Type *getPointer(const Type *base);
+
+  bool isInt() const { return tag == TypeTag::Int32; }
+  bool isUnit() const { return tag == TypeTag::Unit; }
+  bool isArray() const { return tag == TypeTag::Array; }
+  bool isPointer() const { return tag == TypeTag::Pointer; }
+  // size in bytes
+  int size() const;
+  string dump() const;
+};
+
+enum class ValueKind
+{
+  Integer,
+  ZeroInit,
+  Undef,
+  Aggregate,
+  FuncArg,
+  GlobalAlloc,
+  Alloc,
+  Load,
+  Store,
+  GetPtr,
+  GetElemPtr,
+  Binary,
+  Branch,
+  Jump,
+  Call,
+  Ret,
+  Phi
+};
+
+enum class BinaryOp
+{
+  NotEq,
+  Eq,
+  Gt,
+  Lt,
+  Ge,
+  Le,
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Mod,
+  And,
+  Or,
+  Xor,
+  Shl,
+  Shr,
+  Sar
+};
+
+struct BasicBlock;
+struct Function;
+struct Module;
+
+/**
+ * @brief A Koopa value: constant, global, argument or instruction
+ * @details Operand layout by kind:
+ *
+ *  Load: src | Store: value, dest | GetPtr/GetElemPtr: src, index
+ *
+ *  Binary: lhs, rhs | Branch: cond, blocks = {true, false} | Jump: blocks = {target}
+ *
+ *  Call: args, callee | Ret: [value] | Phi: ops[i] flows in from blocks[i]
+ *
+ *  GlobalAlloc: init | Aggregate: elements
+ *
+ * Constants do not keep a user list, every other value does.
+ */
+struct Value
+{
+  ValueKind kind;
+  const Type *ty;
+  string name;
+  int imm = 0;
+  BinaryOp op = BinaryOp::Add;
+  Function *callee = nullptr;
+  vector<Value *> ops;
+  vector<BasicBlock *> blocks;
+  vector<Value *> users;
+  BasicBlock *parent = nullptr;
+
+  Value(ValueKind kind, const Type *ty) : kind(kind), ty(ty) {}
+
+  bool isConstant() const
+  {
+    return kind == ValueKind::Integer || kind == ValueKind::ZeroInit ||
+           kind == ValueKind::Undef || kind == ValueKind::Aggregate;
+  }
+  bool isInt(int v) const { return kind == ValueKind::Integer && imm == v; }
+  bool isTerminator() const
+  {
+    return kind == ValueKind::Branch || kind == ValueKind::Jump || kind == ValueKind::Ret;
+  }
+  bool isInst() const { return parent != nullptr; }
+  // instructions which must not be removed even if their result is unused
+  bool hasSideEffect() const
+  {
+    return kind == ValueKind::Store || kind == ValueKind::Call || isTerminator();
+  }
+
+  void addOperand(Value *v);
+  void setOperand(size_t i, Value *v);
+  void removeOperand(size_t i);
+  void dropOperands();
+  void replaceAllUsesWith(Value *v);
+};
+
+struct BasicBlock
+{
+  string name;
+  Function *parent = nullptr;
+  list<Value *> insts;
+  // valid after Function::buildCFG()
+  vector<BasicBlock *> preds;
+
+  Value *terminator() const
+  {
+    return !insts.empty() && insts.back()->isTerminator() ? insts.back() : nullptr;
+  }
+  vector<BasicBlock *> successors() const;
+  list<Value *>::iterator find(Value *inst);
+
+  void push_back(Value *inst);
+  // insert before the terminator, or at the end if there is none
+  void insertBeforeTerminator(Value *inst);
+  void insertBefore(Value *pos, Value *inst);
+  void insertAfter(Value *pos, Value *inst);
+  // unlink the instruction without touching its operands
+  void remove(Value *inst);
+  // unlink the instruction and drop its operands
+  void erase(Value *inst);
+};
+
+struct Function
+{
+  string name;
+  const Type *retTy;
+  vector<const Type *> paramTys;
+  vector<Value *> params;
+  list<BasicBlock *> blocks;
+  Module *parent = nullptr;
+
+  bool isDecl() const { return blocks.empty(); }
+  BasicBlock *entry() const { return blocks.front(); }
+  BasicBlock *newBlock(const string &hint);
+  void removeBlock(BasicBlock *bb);
+  void buildCFG();
+};
+
+struct Module
+{
+  vector<Value *> globals;
+  vector<unique_ptr<Function>> funcs;
+
+  Module() { _labels.insert("%entry"); }
+
+  Function *getFunction(const string &name) const;
+  Function *newFunction(const string &name, const Type *retTy);
+  // returns a label which is unique in the whole program, the backend emits labels globally
+  string uniqueLabel(const string &hint);
+
+  Value *getInt(int v);
+  Value *getUndef(const Type *ty);
+  Value *getZeroInit(const Type *ty);
+  Value *create(ValueKind kind, const Type *ty);
+  Value *createAlloc(const Type *ty);
+  Value *createLoad(Value *src);
+  Value *createStore(Value *value, Value *dest);
+  Value *createGetPtr(Value *src, Value *index);
+  Value *createGetElemPtr(Value *src, Value *index);
+  Value *createBinary(BinaryOp op, Value *lhs, Value *rhs);
+  Value *createBranch(Value *cond, BasicBlock *t, BasicBlock *f);
+  Value *createJump(BasicBlock *target);
+  Value *createCall(Function *callee, const vector<Value *> &args);
+  Value *createRet(Value *v = nullptr);
+  Value *createPhi(const Type *ty);
+
+private:
+  deque<unique_ptr<Value>> _values;
+  deque<unique_ptr<BasicBlock>> _blocks;
+  map<int, Value *> _ints;
+  set<string> _labels;
+  friend struct Function;
+};
+
+unique_ptr<Module> ParseIR(const string &text);
+string DumpIR(const Module &m);
+
+// CFG helpers
+void ReplaceSuccessor(BasicBlock *bb, BasicBlock *from, BasicBlock *to);
+// rewrite the incoming block of phis in bb
+void ReplacePhiIncoming(BasicBlock *bb, BasicBlock *from, BasicBlock *to);
+void RemovePhiIncoming(BasicBlock *bb, BasicBlock *from);
+vector<Value *> Phis(BasicBlock *bb);
+// blocks in reverse post order starting from the entry
+vector<BasicBlock *> ReversePostOrder(Function &f);
+// move the instructions after pos into a new block, phis of the successors follow
+BasicBlock *SplitBlock(BasicBlock *bb, Value *pos, const string &hint);
+// copy blocks to the end of f, operands found in vmap are substituted and vmap
+// receives the copy of every instruction, branches leaving the region are kept
+vector<BasicBlock *> CloneBlocks(const vector<BasicBlock *> &blocks, Function &f, map<Value *, Value *> &vmap);
+
+// whether inst gives the same result wherever it is executed and may be executed speculatively
+bool IsSpeculatable(Value *inst);
+// the result of op on two constants, none for a division by zero or overflow
+std::optional<int> FoldBinary(BinaryOp op, int l, int r);
+bool IsCommutative(BinaryOp op);
+// the comparison with its operands exchanged, x op y is y swapped(op) x
+BinaryOp SwappedCompare(BinaryOp op);
+// the comparison which holds exactly when op does not
+BinaryOp NegatedCompare(BinaryOp op);
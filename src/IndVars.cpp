@@ -0,0 +1,319 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+// a * b, folded if both are constants, otherwise computed at the end of bb
+static Value *Multiply(BasicBlock *bb, Value *a, Value *b)
+{
+  auto &m = *bb->parent->parent;
+  if (a->kind == ValueKind::Integer && b->kind == ValueKind::Integer)
+    return m.getInt(unsigned(a->imm) * unsigned(b->imm));
+  auto res = m.createBinary(BinaryOp::Mul, a, b);
+  bb->insertBeforeTerminator(res);
+  return res;
+}
+
+// a new induction variable of the loop which is start on entry and advanced by next
+static Value *NewInductionVar(Loop *loop, const InductionVar &iv, Value *start, Value *next)
+{
+  auto &m = *iv.phi->parent->parent->parent;
+  auto h = loop->header;
+  auto phi = m.createPhi(start->ty);
+  h->insertBefore(h->insts.front(), phi);
+  for (size_t i = 0; i < iv.phi->ops.size(); ++i)
+  {
+    phi->addOperand(iv.phi->ops[i] == iv.init ? start : next);
+    phi->blocks.push_back(iv.phi->blocks[i]);
+  }
+  // the new variable advances exactly where the basic one does
+  next->setOperand(0, phi);
+  iv.next->parent->insertAfter(iv.next, next);
+  return phi;
+}
+
+// idx == phi + offset with a loop invariant offset, which is nullptr for idx == phi
+static bool MatchOffset(Loop *loop, const InductionVar &iv, Value *idx, Value *&offset)
+{
+  auto &m = *iv.phi->parent->parent->parent;
+  offset = nullptr;
+  if (idx == iv.phi)
+    return true;
+  if (idx->kind != ValueKind::Binary || !loop->contains(idx))
+    return false;
+  auto l = idx->ops[0], r = idx->ops[1];
+  if (idx->op == BinaryOp::Add && (l == iv.phi || r == iv.phi))
+  {
+    offset = l == iv.phi ? r : l;
+    return loop->isInvariant(offset);
+  }
+  if (idx->op == BinaryOp::Sub && l == iv.phi && r->kind == ValueKind::Integer && r->imm != INT_MIN)
+  {
+    offset = m.getInt(-r->imm);
+    return true;
+  }
+  return false;
+}
+
+// a new pointer variable costs an increment and a copy through its phi slot on every
+// trip, which only pays off when it serves several addresses
+static const int kMinAddresses = 3;
+
+// base[phi + k] with base loop invariant becomes p[k], p being a pointer stepping with phi
+static bool ReduceAddresses(Loop *loop, const InductionVar &iv)
+{
+  auto &m = *iv.phi->parent->parent->parent;
+  auto ph = loop->preheader();
+  vector<Value *> idxs = {iv.phi};
+  for (auto u : iv.phi->users)
+    if (u->kind == ValueKind::Binary && std::find(idxs.begin(), idxs.end(), u) == idxs.end())
+      idxs.push_back(u);
+  map<std::pair<Value *, ValueKind>, vector<std::pair<Value *, Value *>>> groups;
+  set<Value *> seen;
+  for (auto idx : idxs)
+  {
+    Value *offset;
+    if (!MatchOffset(loop, iv, idx, offset))
+      continue;
+    for (auto u : idx->users)
+      if ((u->kind == ValueKind::GetElemPtr || u->kind == ValueKind::GetPtr) && u->ops[1] == idx &&
+          loop->contains(u) && loop->isInvariant(u->ops[0]) && seen.insert(u).second)
+        groups[{u->ops[0], u->kind}].emplace_back(u, offset);
+  }
+
+  bool changed = false;
+  for (auto &[key, addrs] : groups)
+  {
+    if (addrs.size() < kMinAddresses)
+      continue;
+    auto [base, kind] = key;
+    auto start = kind == ValueKind::GetElemPtr ? m.createGetElemPtr(base, iv.init) : m.createGetPtr(base, iv.init);
+    ph->insertBeforeTerminator(start);
+    auto p = NewInductionVar(loop, iv, start, m.createGetPtr(start, iv.step));
+    for (auto [addr, offset] : addrs)
+    {
+      Value *res = p;
+      if (offset)
+      {
+        res = m.createGetPtr(p, offset);
+        addr->parent->insertBefore(addr, res);
+      }
+      addr->replaceAllUsesWith(res);
+      addr->parent->erase(addr);
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+static bool IsMultiplyByInvariant(Loop *loop, Value *inst, Value *v)
+{
+  return inst->kind == ValueKind::Binary && inst->op == BinaryOp::Mul && loop->contains(inst) &&
+         (inst->ops[0] == v || inst->ops[1] == v) && loop->isInvariant(inst->ops[0] == v ? inst->ops[1] : inst->ops[0]);
+}
+
+/**
+ * @brief The test which ends a loop counting towards a constant bound
+ * @details cmp compares the phi or its next value, the operand at pos, against a
+ * constant. Every value the counter takes lies within [lo, hi].
+ */
+struct ExitTest
+{
+  Value *cmp;
+  int pos;
+  int64_t lo, hi;
+};
+
+static bool FindExitTest(Loop *loop, const InductionVar &iv, ExitTest &test)
+{
+  if (iv.init->kind != ValueKind::Integer || iv.step->kind != ValueKind::Integer)
+    return false;
+  Value *cmp = nullptr;
+  for (auto u : iv.phi->users)
+    if (u->kind == ValueKind::Binary && u->op <= BinaryOp::Le && u != cmp)
+    {
+      if (cmp)
+        return false;
+      cmp = u;
+    }
+  for (auto u : iv.next->users)
+    if (u->kind == ValueKind::Binary && u->op <= BinaryOp::Le && u != cmp)
+    {
+      if (cmp)
+        return false;
+      cmp = u;
+    }
+  if (!cmp || cmp->users.size() != 1)
+    return false;
+  auto br = cmp->users[0];
+  auto bb = br->parent;
+  // the test must run on every trip
+  if (br->kind != ValueKind::Branch || (bb != loop->header && bb != loop->latches()[0]))
+    return false;
+  bool stay = loop->contains(br->blocks[0]);
+  if (stay == loop->contains(br->blocks[1]))
+    return false;
+
+  test.cmp = cmp;
+  test.pos = cmp->ops[0] == iv.phi || cmp->ops[0] == iv.next ? 0 : 1;
+  auto var = cmp->ops[test.pos], bound = cmp->ops[1 - test.pos];
+  if (bound->kind != ValueKind::Integer || bound == var)
+    return false;
+  // normalize to "var op bound" which keeps the loop running
+  auto op = test.pos == 0 ? cmp->op : SwappedCompare(cmp->op);
+  if (!stay)
+  {
+    static const map<BinaryOp, BinaryOp> negated = {
+        {BinaryOp::Lt, BinaryOp::Ge}, {BinaryOp::Ge, BinaryOp::Lt}, {BinaryOp::Gt, BinaryOp::Le}, {BinaryOp::Le, BinaryOp::Gt}};
+    if (!negated.count(op))
+      return false;
+    op = negated.at(op);
+  }
+  // a counter moving towards the bound stays between init and the bound
+  int64_t step = iv.step->imm;
+  bool up = op == BinaryOp::Lt || op == BinaryOp::Le, down = op == BinaryOp::Gt || op == BinaryOp::Ge;
+  if (!((up && step > 0) || (down && step < 0)))
+    return false;
+  test.lo = std::min<int64_t>(iv.init->imm, bound->imm) - std::abs(step);
+  test.hi = std::max<int64_t>(iv.init->imm, bound->imm) + std::abs(step);
+  return true;
+}
+
+/**
+ * @brief Strength reduction of multiplications with linear function test replacement
+ * @details A counter which only feeds multiplications by loop invariants, its own
+ * increment and the exit test is replaced by one scaled variable per factor, each
+ * advancing by an addition. The exit test moves onto a variable with a positive
+ * constant factor, scaling the bound at compile time, which leaves the counter dead.
+ * Without the last step the new variables would cost more than the multiplications
+ * they replace, so nothing is done unless the counter goes away.
+ */
+static bool ReplaceCounter(Loop *loop, const InductionVar &iv)
+{
+  auto &m = *iv.phi->parent->parent->parent;
+  ExitTest test;
+  if (!FindExitTest(loop, iv, test))
+    return false;
+  vector<Value *> muls;
+  Value *scale = nullptr;
+  for (auto u : iv.phi->users)
+  {
+    // dead leftovers of the address rewrite do not count, stores and calls do
+    if (u == iv.next || u == test.cmp || (!u->hasSideEffect() && u->users.empty()) ||
+        std::find(muls.begin(), muls.end(), u) != muls.end())
+      continue;
+    if (!IsMultiplyByInvariant(loop, u, iv.phi))
+      return false;
+    muls.push_back(u);
+    auto factor = u->ops[0] == iv.phi ? u->ops[1] : u->ops[0];
+    if (!scale && factor->kind == ValueKind::Integer && factor->imm > 0 &&
+        test.lo * factor->imm >= INT_MIN && test.hi * factor->imm <= INT_MAX)
+      scale = factor;
+  }
+  for (auto u : iv.next->users)
+    if (u != iv.phi && u != test.cmp && (u->hasSideEffect() || !u->users.empty()))
+      return false;
+  if (!scale)
+    return false;
+
+  auto ph = loop->preheader();
+  map<Value *, std::pair<Value *, Value *>> scaled;
+  for (auto mul : muls)
+  {
+    auto factor = mul->ops[0] == iv.phi ? mul->ops[1] : mul->ops[0];
+    auto &var = scaled[factor];
+    if (!var.first)
+    {
+      auto next = m.createBinary(BinaryOp::Add, Multiply(ph, iv.init, factor), Multiply(ph, iv.step, factor));
+      var = {NewInductionVar(loop, iv, next->ops[0], next), next};
+    }
+    mul->replaceAllUsesWith(var.first);
+    mul->parent->erase(mul);
+  }
+  auto cmp = test.cmp;
+  auto &var = scaled[scale];
+  auto bound = cmp->ops[1 - test.pos]->imm;
+  cmp->setOperand(test.pos, cmp->ops[test.pos] == iv.phi ? var.first : var.second);
+  cmp->setOperand(1 - test.pos, m.getInt(bound * scale->imm));
+  return true;
+}
+
+/**
+ * @brief Induction variable strength reduction
+ * @details For every basic induction variable, array addresses indexed by it become
+ * pointers which advance by the stride each trip, and a counter which is only
+ * multiplied is replaced by its scaled versions, see ReplaceCounter.
+ */
+bool StrengthReduce(Function &f)
+{
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    if (!li.insertPreheader(loop))
+      continue;
+    for (auto &iv : FindInductionVars(loop))
+    {
+      changed |= ReduceAddresses(loop, iv);
+      changed |= ReplaceCounter(loop, iv);
+    }
+  }
+  return changed;
+}
+
+/**
+ * @brief Replace loops by the closed form of their exit values
+ * @details A loop without stores, calls or inner loops, whose trip count is known,
+ * only computes the values used after it. If all of them are add recurrences they
+ * are evaluated in the preheader, which then jumps straight to the exit. The loops
+ * are found anew after each one replaced, as the CFG has changed.
+ */
+bool ClosedFormLoops(Function &f)
+{
+  bool changed = false;
+  for (bool again = true; again;)
+  {
+    again = false;
+    DominatorTree dt(f);
+    LoopInfo li(f, dt);
+    ScalarEvolution se;
+    for (auto loop : li.postOrder())
+    {
+      if (!loop->subLoops.empty() || !li.insertPreheader(loop))
+        continue;
+      auto exits = loop->exitBlocks();
+      if (exits.size() != 1)
+        continue;
+      bool ok = true;
+      vector<Value *> live;
+      for (auto bb : loop->blocks)
+        for (auto inst : bb->insts)
+        {
+          if (inst->kind == ValueKind::Store || inst->kind == ValueKind::Call)
+            ok = false;
+          if (std::any_of(inst->users.begin(), inst->users.end(), [&](Value *u)
+                          { return !loop->contains(u); }))
+          {
+            live.push_back(inst);
+            ok = ok && se.get(inst, loop);
+          }
+        }
+      if (!ok)
+        continue;
+      auto ph = loop->preheader(), h = loop->header, exit = exits[0];
+      auto k = se.expandTripCount(loop, ph);
+      if (!k)
+        continue;
+      for (auto v : live)
+        v->replaceAllUsesWith(se.expand(*se.get(v, loop), k, ph));
+      ReplacePhiIncoming(exit, h, ph);
+      ReplaceSuccessor(ph, h, exit);
+      RemoveUnreachableBlocks(f);
+      changed = again = true;
+      break;
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,184 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <functional>
+
+// callees of at most this many instructions are always inlined
+static const int kInlineThreshold = 30;
+// calls inside loops run often, so larger callees pay off there
+static const int kLoopThreshold = 120;
+// no function grows beyond this by inlining
+static const int kMaxFunctionSize = 3000;
+
+static int Size(Function &f)
+{
+  int size = 0;
+  for (auto bb : f.blocks)
+    size += bb->insts.size();
+  return size;
+}
+
+/**
+ * @brief Strongly connected components of the call graph
+ * @details Tarjan's algorithm, which finishes the callees of a function before the
+ * function itself, so the functions come out bottom up. Functions in a cycle, or
+ * calling themselves, are marked as recursive.
+ */
+static vector<Function *> BottomUpOrder(Module &m, set<Function *> &recursive)
+{
+  vector<Function *> order, stack;
+  unordered_map<Function *, int> index, low;
+  set<Function *> onStack;
+  std::function<void(Function *)> visit = [&](Function *f)
+  {
+    index[f] = low[f] = index.size();
+    stack.push_back(f);
+    onStack.insert(f);
+    for (auto bb : f->blocks)
+      for (auto inst : bb->insts)
+      {
+        if (inst->kind != ValueKind::Call)
+          continue;
+        auto g = inst->callee;
+        if (g == f)
+          recursive.insert(f);
+        if (!index.count(g))
+        {
+          visit(g);
+          low[f] = std::min(low[f], low[g]);
+        }
+        else if (onStack.count(g))
+          low[f] = std::min(low[f], index[g]);
+      }
+    if (low[f] != index[f])
+      return;
+    vector<Function *> scc;
+    do
+    {
+      scc.push_back(stack.back());
+      onStack.erase(stack.back());
+      stack.pop_back();
+    } while (scc.back() != f);
+    if (scc.size() > 1)
+      recursive.insert(scc.begin(), scc.end());
+    order.insert(order.end(), scc.begin(), scc.end());
+  };
+  for (auto &f : m.funcs)
+    if (!index.count(f.get()))
+      visit(f.get());
+  return order;
+}
+
+// replace the call by a copy of the body of its callee
+static void InlineCall(Value *call)
+{
+  auto bb = call->parent;
+  auto &f = *bb->parent;
+  auto &m = *f.parent;
+  auto callee = call->callee;
+  auto cont = SplitBlock(bb, call, bb->name + "_cont");
+
+  map<Value *, Value *> vmap;
+  for (size_t i = 0; i < callee->params.size(); ++i)
+    vmap[callee->params[i]] = call->ops[i];
+  vector<BasicBlock *> blocks(callee->blocks.begin(), callee->blocks.end());
+  auto body = CloneBlocks(blocks, f, vmap);
+
+  auto entry = f.entry();
+  vector<std::pair<Value *, BasicBlock *>> rets;
+  for (auto b : body)
+  {
+    // the frame of the callee becomes part of the frame of the caller
+    for (auto it = b->insts.begin(); it != b->insts.end();)
+    {
+      auto inst = *it++;
+      if (inst->kind != ValueKind::Alloc)
+        continue;
+      b->remove(inst);
+      entry->insertBefore(entry->insts.front(), inst);
+    }
+    auto ret = b->terminator();
+    if (!ret || ret->kind != ValueKind::Ret)
+      continue;
+    if (!ret->ops.empty())
+      rets.emplace_back(ret->ops[0], b);
+    b->erase(ret);
+    b->push_back(m.createJump(cont));
+  }
+
+  if (!call->ty->isUnit())
+  {
+    Value *res = m.getUndef(call->ty);
+    if (rets.size() == 1)
+      res = rets[0].first;
+    else if (rets.size() > 1)
+    {
+      res = m.createPhi(call->ty);
+      for (auto [v, from] : rets)
+      {
+        res->addOperand(v);
+        res->blocks.push_back(from);
+      }
+      cont->insts.push_front(res);
+      res->parent = cont;
+    }
+    call->replaceAllUsesWith(res);
+  }
+  bb->erase(call);
+  bb->push_back(m.createJump(body.front()));
+}
+
+/**
+ * @brief Inline calls guided by a size cost model
+ * @details Functions are visited bottom up over the call graph, so a callee has
+ * already absorbed its own callees when its size is measured. A call is inlined when
+ * the callee is small, larger inside loops, or when it is the only call to the callee.
+ * Recursive functions are never inlined and no caller grows beyond a fixed budget.
+ */
+bool Inline(Module &m)
+{
+  set<Function *> recursive;
+  auto order = BottomUpOrder(m, recursive);
+  map<Function *, int> sites;
+  for (auto f : order)
+    for (auto bb : f->blocks)
+      for (auto inst : bb->insts)
+        if (inst->kind == ValueKind::Call)
+          ++sites[inst->callee];
+
+  bool changed = false;
+  for (auto f : order)
+  {
+    if (f->isDecl())
+      continue;
+    vector<std::pair<Value *, bool>> calls;
+    {
+      DominatorTree dt(*f);
+      LoopInfo li(*f, dt);
+      for (auto bb : f->blocks)
+        for (auto inst : bb->insts)
+          if (inst->kind == ValueKind::Call)
+            calls.emplace_back(inst, li.loopOf.count(bb));
+    }
+    int size = Size(*f);
+    for (auto [call, inLoop] : calls)
+    {
+      auto callee = call->callee;
+      if (callee->isDecl() || recursive.count(callee))
+        continue;
+      int calleeSize = Size(*callee);
+      bool small = calleeSize <= (inLoop ? kLoopThreshold : kInlineThreshold);
+      if ((!small && sites[callee] != 1) || size + calleeSize > kMaxFunctionSize)
+        continue;
+      for (auto bb : callee->blocks)
+        for (auto inst : bb->insts)
+          if (inst->kind == ValueKind::Call)
+            ++sites[inst->callee];
+      --sites[callee];
+      InlineCall(call);
+      size += calleeSize;
+      changed = true;
+    }
+  }
+  return changed;
+}
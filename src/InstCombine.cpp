@@ -0,0 +1,285 @@
+#include "Pass.hpp"
+#include <optional>
+
+static bool IsCompare(Value *v) { return v->kind == ValueKind::Binary && v->op <= BinaryOp::Le; }
+
+static bool Is(Value *v, BinaryOp op) { return v->kind == ValueKind::Binary && v->op == op; }
+
+// whether v is 0 - x
+static bool IsNeg(Value *v) { return Is(v, BinaryOp::Sub) && v->ops[0]->isInt(0); }
+
+static std::optional<int> ConstantOf(Value *v)
+{
+  if (v->kind == ValueKind::Integer)
+    return v->imm;
+  return std::nullopt;
+}
+
+// whether v is always 0 or 1, looking through a few levels of logic and phis
+static bool IsBoolean(Value *v, int depth = 0)
+{
+  if (v->kind == ValueKind::Integer)
+    return v->imm == 0 || v->imm == 1;
+  if (depth > 3)
+    return false;
+  if (IsCompare(v))
+    return true;
+  if (Is(v, BinaryOp::And))
+    return IsBoolean(v->ops[0], depth + 1) || IsBoolean(v->ops[1], depth + 1);
+  if (Is(v, BinaryOp::Or) || Is(v, BinaryOp::Xor))
+    return IsBoolean(v->ops[0], depth + 1) && IsBoolean(v->ops[1], depth + 1);
+  if (v->kind == ValueKind::Phi)
+  {
+    for (auto op : v->ops)
+      if (op != v && !IsBoolean(op, depth + 1))
+        return false;
+    return true;
+  }
+  return false;
+}
+
+class Combiner
+{
+  Module &_m;
+  vector<Value *> _work;
+  set<Value *> _queued;
+
+public:
+  bool changed = false;
+
+  explicit Combiner(Module &m) : _m(m) {}
+
+  void push(Value *v)
+  {
+    if (v->isInst() && _queued.insert(v).second)
+      _work.push_back(v);
+  }
+
+  void run()
+  {
+    while (!_work.empty())
+    {
+      auto inst = _work.back();
+      _work.pop_back();
+      _queued.erase(inst);
+      if (!inst->parent)
+        continue;
+      if (auto v = combine(inst))
+      {
+        for (auto u : inst->users)
+          push(u);
+        inst->replaceAllUsesWith(v);
+        inst->parent->erase(inst);
+        push(v);
+        changed = true;
+      }
+    }
+  }
+
+private:
+  // a new instruction computing l op r right before pos
+  Value *emit(Value *pos, BinaryOp op, Value *l, Value *r)
+  {
+    auto res = _m.createBinary(op, l, r);
+    pos->parent->insertBefore(pos, res);
+    push(res);
+    return res;
+  }
+
+  // rewrite inst in place to l op r
+  Value *rewrite(Value *inst, BinaryOp op, Value *l, Value *r)
+  {
+    inst->op = op;
+    inst->setOperand(0, l);
+    inst->setOperand(1, r);
+    push(inst);
+    for (auto u : inst->users)
+      push(u);
+    changed = true;
+    return nullptr;
+  }
+
+  Value *combine(Value *inst)
+  {
+    if (inst->kind == ValueKind::Binary)
+      return combineBinary(inst);
+    if (inst->kind == ValueKind::Branch)
+      combineBranch(inst);
+    return nullptr;
+  }
+
+  // branch on x rather than on x != 0, and on x with the targets exchanged for x == 0
+  void combineBranch(Value *br)
+  {
+    auto cond = br->ops[0];
+    if (!(Is(cond, BinaryOp::NotEq) || Is(cond, BinaryOp::Eq)) || !cond->ops[1]->isInt(0))
+      return;
+    br->setOperand(0, cond->ops[0]);
+    if (cond->op == BinaryOp::Eq)
+      std::swap(br->blocks[0], br->blocks[1]);
+    changed = true;
+    push(br);
+  }
+
+  // the replacement of a binary instruction, which may also be changed in place
+  Value *combineBinary(Value *inst)
+  {
+    auto op = inst->op;
+    auto l = inst->ops[0], r = inst->ops[1];
+    if (auto a = ConstantOf(l))
+    {
+      if (auto b = ConstantOf(r))
+      {
+        auto v = FoldBinary(op, *a, *b);
+        return v ? _m.getInt(*v) : nullptr;
+      }
+      // constants go to the right
+      if (IsCommutative(op))
+        return rewrite(inst, op, r, l);
+      if (IsCompare(inst))
+        return rewrite(inst, SwappedCompare(op), r, l);
+    }
+    if (IsCompare(inst))
+      return combineCompare(inst);
+
+    auto c = ConstantOf(r);
+    switch (op)
+    {
+    case BinaryOp::Add:
+      if (c == 0)
+        return l;
+      if (IsNeg(r))
+        return rewrite(inst, BinaryOp::Sub, l, r->ops[1]);
+      if (IsNeg(l))
+        return rewrite(inst, BinaryOp::Sub, r, l->ops[1]);
+      if (c && Is(l, BinaryOp::Add) && ConstantOf(l->ops[1]))
+        return rewrite(inst, BinaryOp::Add, l->ops[0], _m.getInt(unsigned(*c) + unsigned(l->ops[1]->imm)));
+      // (c1 - x) + c is (c1 + c) - x
+      if (c && Is(l, BinaryOp::Sub) && ConstantOf(l->ops[0]))
+        return rewrite(inst, BinaryOp::Sub, _m.getInt(unsigned(*c) + unsigned(l->ops[0]->imm)), l->ops[1]);
+      break;
+    case BinaryOp::Sub:
+      if (l == r)
+        return _m.getInt(0);
+      // subtracting a constant is adding its negation, which reassociates
+      if (c)
+        return rewrite(inst, BinaryOp::Add, l, _m.getInt(-unsigned(*c)));
+      if (IsNeg(r))
+        return l->isInt(0) ? r->ops[1] : rewrite(inst, BinaryOp::Add, l, r->ops[1]);
+      if (ConstantOf(l) && Is(r, BinaryOp::Add) && ConstantOf(r->ops[1]))
+        return rewrite(inst, BinaryOp::Sub, _m.getInt(unsigned(l->imm) - unsigned(r->ops[1]->imm)), r->ops[0]);
+      break;
+    case BinaryOp::Mul:
+      if (c == 0 || c == 1)
+        return *c ? l : r;
+      if (c == -1)
+        return rewrite(inst, BinaryOp::Sub, _m.getInt(0), l);
+      if (c && Is(l, BinaryOp::Mul) && ConstantOf(l->ops[1]))
+        return rewrite(inst, BinaryOp::Mul, l->ops[0], _m.getInt(unsigned(*c) * unsigned(l->ops[1]->imm)));
+      if (IsNeg(l) && IsNeg(r))
+        return rewrite(inst, BinaryOp::Mul, l->ops[1], r->ops[1]);
+      break;
+    case BinaryOp::Div:
+      if (c == 1)
+        return l;
+      if (c == -1)
+        return rewrite(inst, BinaryOp::Sub, _m.getInt(0), l);
+      break;
+    case BinaryOp::Mod:
+      if (c == 1 || c == -1)
+        return _m.getInt(0);
+      break;
+    case BinaryOp::And:
+      if (c == 0 || c == -1 || l == r)
+        return c == 0 ? r : l;
+      if (c == 1 && IsBoolean(l))
+        return l;
+      if (c && Is(l, BinaryOp::And) && ConstantOf(l->ops[1]))
+        return rewrite(inst, BinaryOp::And, l->ops[0], _m.getInt(*c & l->ops[1]->imm));
+      break;
+    case BinaryOp::Or:
+      if (c == 0 || c == -1 || l == r)
+        return c == -1 ? r : l;
+      if (c && Is(l, BinaryOp::Or) && ConstantOf(l->ops[1]))
+        return rewrite(inst, BinaryOp::Or, l->ops[0], _m.getInt(*c | l->ops[1]->imm));
+      break;
+    case BinaryOp::Xor:
+      if (c == 0)
+        return l;
+      if (l == r)
+        return _m.getInt(0);
+      if (c == 1 && IsCompare(l))
+        return emit(inst, NegatedCompare(l->op), l->ops[0], l->ops[1]);
+      if (c && Is(l, BinaryOp::Xor) && ConstantOf(l->ops[1]))
+        return rewrite(inst, BinaryOp::Xor, l->ops[0], _m.getInt(*c ^ l->ops[1]->imm));
+      break;
+    case BinaryOp::Shl:
+    case BinaryOp::Shr:
+    case BinaryOp::Sar:
+      if (c && (*c & 31) == 0)
+        return l;
+      if (l->isInt(0))
+        return l;
+      break;
+    default:
+      break;
+    }
+    return nullptr;
+  }
+
+  Value *combineCompare(Value *inst)
+  {
+    auto op = inst->op;
+    auto l = inst->ops[0], r = inst->ops[1];
+    if (l == r)
+      return _m.getInt(op == BinaryOp::Eq || op == BinaryOp::Le || op == BinaryOp::Ge);
+    auto c = ConstantOf(r);
+    if (!c)
+      return nullptr;
+    if (IsBoolean(l))
+    {
+      // a boolean tested against 0 or 1 is itself or its negation
+      bool same = (op == BinaryOp::NotEq && c == 0) || (op == BinaryOp::Eq && c == 1) ||
+                  (op == BinaryOp::Gt && c == 0) || (op == BinaryOp::Ge && c == 1);
+      bool negated = (op == BinaryOp::Eq && c == 0) || (op == BinaryOp::NotEq && c == 1) ||
+                     (op == BinaryOp::Lt && c == 1) || (op == BinaryOp::Le && c == 0);
+      if (same)
+        return l;
+      if (negated && IsCompare(l))
+        return emit(inst, NegatedCompare(l->op), l->ops[0], l->ops[1]);
+      if (negated)
+        return op == BinaryOp::Eq ? nullptr : rewrite(inst, BinaryOp::Eq, l, _m.getInt(0));
+      if (op == BinaryOp::Eq && c != 0 && c != 1)
+        return _m.getInt(0);
+      if (op == BinaryOp::NotEq && c != 0 && c != 1)
+        return _m.getInt(1);
+    }
+    if (op != BinaryOp::Eq && op != BinaryOp::NotEq)
+      return nullptr;
+    // equality is preserved by adding the same value to both sides
+    if (Is(l, BinaryOp::Sub) && c == 0)
+      return rewrite(inst, op, l->ops[0], l->ops[1]);
+    if (Is(l, BinaryOp::Add) && ConstantOf(l->ops[1]))
+      return rewrite(inst, op, l->ops[0], _m.getInt(unsigned(*c) - unsigned(l->ops[1]->imm)));
+    if (IsNeg(l))
+      return rewrite(inst, op, l->ops[1], _m.getInt(-unsigned(*c)));
+    return nullptr;
+  }
+};
+
+/**
+ * @brief Peephole simplification of local patterns
+ * @details Constants are moved to the right and folded into the operations they
+ * feed, identity and absorbing operands are removed, negations are merged into
+ * additions, and tests of booleans become the boolean or its negated comparison.
+ * A worklist revisits the users of everything changed until nothing matches.
+ */
+bool InstCombine(Function &f)
+{
+  Combiner combiner(*f.parent);
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      combiner.push(inst);
+  combiner.run();
+  return combiner.changed;
+}
@@ -0,0 +1,61 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+/**
+ * @brief Loop invariant code motion
+ * @details Loops are visited from the innermost outwards. Pure instructions whose
+ * operands are defined outside the loop move to the preheader, and so do loads no
+ * store or call in the loop may clobber, provided the load would run on every trip
+ * or its address is known to be valid.
+ */
+bool LICM(Function &f)
+{
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    bool fresh = !loop->preheader();
+    auto ph = li.insertPreheader(loop);
+    if (!ph)
+      continue;
+    if (fresh)
+      dt = DominatorTree(f);
+
+    vector<Value *> clobbers;
+    for (auto bb : loop->blocks)
+      for (auto inst : bb->insts)
+        if (inst->kind == ValueKind::Store || inst->kind == ValueKind::Call)
+          clobbers.push_back(inst);
+    auto exiting = loop->exitingBlocks();
+    auto executed = [&](BasicBlock *bb)
+    {
+      return std::all_of(exiting.begin(), exiting.end(), [&](BasicBlock *e)
+                         { return dt.dominates(bb, e); });
+    };
+
+    for (auto bb : loop->blocks)
+      for (auto it = bb->insts.begin(); it != bb->insts.end();)
+      {
+        auto inst = *it++;
+        if (!std::all_of(inst->ops.begin(), inst->ops.end(), [&](Value *v)
+                         { return loop->isInvariant(v); }))
+          continue;
+        bool hoist = IsSpeculatable(inst);
+        if (inst->kind == ValueKind::Load)
+        {
+          auto ptr = inst->ops[0];
+          hoist = std::none_of(clobbers.begin(), clobbers.end(), [&](Value *c)
+                               { return MayClobber(c, ptr, inst->ty->size()); }) &&
+                  (IsDereferenceable(ptr) || executed(bb));
+        }
+        if (!hoist)
+          continue;
+        bb->remove(inst);
+        ph->insertBeforeTerminator(inst);
+        changed = true;
+      }
+  }
+  return changed;
+}
@@ -0,0 +1,86 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+
+// the value known to be in memory at each address
+typedef map<Value *, Value *> Available;
+
+// forget the values a store or call may overwrite
+static void Clobber(Available &avail, Value *inst)
+{
+  for (auto it = avail.begin(); it != avail.end();)
+    if (MayClobber(inst, it->first, it->second->ty->size()))
+      it = avail.erase(it);
+    else
+      ++it;
+}
+
+// the addresses which hold the same value at the end of every predecessor
+static Available Meet(BasicBlock *bb, const map<BasicBlock *, Available> &out)
+{
+  Available res;
+  for (size_t i = 0; i < bb->preds.size(); ++i)
+  {
+    auto found = out.find(bb->preds[i]);
+    // a back edge, nothing is known about the memory written in the loop
+    if (found == out.end())
+      return {};
+    if (i == 0)
+    {
+      res = found->second;
+      continue;
+    }
+    for (auto it = res.begin(); it != res.end();)
+    {
+      auto other = found->second.find(it->first);
+      if (other == found->second.end() || other->second != it->second)
+        it = res.erase(it);
+      else
+        ++it;
+    }
+  }
+  return res;
+}
+
+/**
+ * @brief Redundant load elimination and store to load forwarding
+ * @details Tracks the value held at each address over the blocks in reverse post
+ * order. A load from an address whose value is known is replaced by that value,
+ * either the value stored there or the result of an earlier load. Stores and calls
+ * forget what they may overwrite according to the alias analysis. The state at a
+ * join is what all predecessors agree on, and a loop header starts with nothing.
+ */
+bool LoadElim(Function &f)
+{
+  f.buildCFG();
+  map<BasicBlock *, Available> out;
+  bool changed = false;
+  for (auto bb : ReversePostOrder(f))
+  {
+    auto avail = Meet(bb, out);
+    for (auto it = bb->insts.begin(); it != bb->insts.end();)
+    {
+      auto inst = *it++;
+      if (inst->kind == ValueKind::Load)
+      {
+        auto found = avail.find(inst->ops[0]);
+        if (found != avail.end() && found->second->ty == inst->ty)
+        {
+          inst->replaceAllUsesWith(found->second);
+          bb->erase(inst);
+          changed = true;
+        }
+        else
+          avail[inst->ops[0]] = inst;
+      }
+      else if (inst->kind == ValueKind::Store)
+      {
+        Clobber(avail, inst);
+        avail[inst->ops[1]] = inst->ops[0];
+      }
+      else if (inst->kind == ValueKind::Call)
+        Clobber(avail, inst);
+    }
+    out[bb] = std::move(avail);
+  }
+  return changed;
+}
@@ -0,0 +1,155 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <numeric>
+
+/**
+ * @brief The instructions of a loop which depend on each other
+ * @details Each group holds the header phis and body instructions connected by uses
+ * or by a dependence between their accesses, the loop control is shared by all.
+ */
+struct Partitions
+{
+  vector<Value *> nodes;
+  vector<size_t> group;
+};
+
+static size_t Find(vector<size_t> &parent, size_t i)
+{
+  while (parent[i] != i)
+    i = parent[i] = parent[parent[i]];
+  return i;
+}
+
+// group the instructions of a loop made of its header and a single body block, none
+// if it calls a function or the dependence analysis cannot follow an access
+static std::optional<Partitions> Partition(Loop *loop, const LoopControl &c)
+{
+  auto h = loop->header, body = loop->blocks[1];
+  Partitions res;
+  for (auto phi : Phis(h))
+    if (phi != c.iv.phi)
+      res.nodes.push_back(phi);
+  for (auto inst : body->insts)
+    if (!inst->isTerminator() && inst != c.iv.next)
+      res.nodes.push_back(inst);
+  map<Value *, size_t> index;
+  for (size_t i = 0; i < res.nodes.size(); ++i)
+    index[res.nodes[i]] = i;
+  vector<size_t> parent(res.nodes.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto unite = [&](size_t a, size_t b)
+  { parent[Find(parent, a)] = Find(parent, b); };
+
+  vector<std::pair<size_t, AccessPattern>> accesses;
+  for (size_t i = 0; i < res.nodes.size(); ++i)
+  {
+    auto inst = res.nodes[i];
+    for (auto op : inst->ops)
+      if (index.count(op))
+        unite(i, index[op]);
+    if (inst->kind == ValueKind::Load || inst->kind == ValueKind::Store)
+    {
+      auto a = AnalyzeAccess(inst, {c.iv.phi}, loop);
+      if (!a)
+        return std::nullopt;
+      accesses.emplace_back(i, *a);
+    }
+    else if (inst->kind != ValueKind::Phi && !IsSpeculatable(inst))
+      return std::nullopt;
+  }
+  for (size_t a = 0; a < accesses.size(); ++a)
+    for (size_t b = a + 1; b < accesses.size(); ++b)
+    {
+      auto &[i, x] = accesses[a];
+      auto &[j, y] = accesses[b];
+      if ((x.isStore || y.isStore) && Dependence(x, y, {c.step}))
+        unite(i, j);
+    }
+  for (size_t i = 0; i < res.nodes.size(); ++i)
+    res.group.push_back(Find(parent, i));
+  return res;
+}
+
+// copy the loop in front of itself, the copy keeping only the instructions in keep
+static void SplitOff(LoopInfo &li, Loop *loop, const set<Value *> &keep, const vector<Value *> &nodes)
+{
+  auto h = loop->header, ph = loop->preheader();
+  auto exit = loop->exitBlocks()[0];
+  auto &f = *h->parent;
+  auto &m = *f.parent;
+  map<Value *, Value *> vmap;
+  auto blocks = CloneBlocks(loop->blocks, f, vmap);
+  auto next = f.newBlock(h->name + "_dist");
+  next->push_back(m.createJump(h));
+  ReplaceSuccessor(ph, h, blocks[0]);
+  ReplaceSuccessor(blocks[0], exit, next);
+  ReplacePhiIncoming(h, ph, next);
+  for (auto inst : nodes)
+    if (!keep.count(inst))
+      vmap[inst]->parent->erase(vmap[inst]);
+  if (loop->parent)
+    for (auto bb : {blocks[0], blocks[1], next})
+      li.addBlock(loop->parent, bb, h);
+  f.buildCFG();
+}
+
+/**
+ * @brief Loop distribution
+ * @details A loop whose body does several unrelated things, like clearing one
+ * array while summing up another, is split into one loop for each part that is a
+ * fill or a copy of an array and one for the rest, so that idiom recognition can
+ * replace them as a whole. The parts are the groups of instructions connected by
+ * uses or by a dependence of their accesses, so the loops can run one after the
+ * other in any order. Only innermost loops of a header and one body block are
+ * split, whose values after the loop all come from header phis.
+ */
+bool LoopDistribution(Function &f)
+{
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    if (!loop->subLoops.empty() || loop->blocks.size() != 2 || !li.insertPreheader(loop))
+      continue;
+    auto c = MatchLoopControl(loop, loop);
+    if (!c || loop->exitBlocks().size() != 1)
+      continue;
+    auto h = loop->header;
+    if (std::any_of(h->insts.begin(), h->insts.end(), [&](Value *v)
+                    { return v->kind != ValueKind::Phi && v != c->cond && !v->isTerminator(); }))
+      continue;
+    auto parts = Partition(loop, *c);
+    if (!parts)
+      continue;
+    map<size_t, vector<Value *>> groups;
+    for (size_t i = 0; i < parts->nodes.size(); ++i)
+      groups[parts->group[i]].push_back(parts->nodes[i]);
+    if (groups.size() < 2)
+      continue;
+    vector<vector<Value *>> idioms;
+    vector<Value *> rest;
+    for (auto &[g, insts] : groups)
+      if (MatchMemoryIdiom(insts, loop, c->iv.phi, c->step))
+        idioms.push_back(insts);
+      else
+        rest.insert(rest.end(), insts.begin(), insts.end());
+    if (idioms.empty())
+      continue;
+    // the loop itself keeps the rest, or the last idiom if there is no rest
+    if (rest.empty())
+    {
+      rest = idioms.back();
+      idioms.pop_back();
+    }
+    for (auto &insts : idioms)
+      SplitOff(li, loop, set<Value *>(insts.begin(), insts.end()), parts->nodes);
+    set<Value *> keep(rest.begin(), rest.end());
+    for (auto inst : parts->nodes)
+      if (!keep.count(inst))
+        inst->parent->erase(inst);
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,165 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// the fused body stays within this many instructions
+static const int kMaxFusedSize = 150;
+
+static int Size(Loop *loop)
+{
+  int size = 0;
+  for (auto bb : loop->blocks)
+    size += bb->insts.size();
+  return size;
+}
+
+static bool SameTrips(const LoopControl &a, const LoopControl &b)
+{
+  return a.iv.init == b.iv.init && a.step == b.step && a.bound == b.bound &&
+         a.pos == b.pos && a.cond->op == b.cond->op;
+}
+
+// the loads and stores of the loop in terms of its induction variable, none if it
+// calls a function or the dependence analysis cannot follow an access
+static std::optional<vector<AccessPattern>> Accesses(Loop *loop, Value *iv)
+{
+  vector<AccessPattern> res;
+  for (auto bb : loop->blocks)
+    for (auto inst : bb->insts)
+    {
+      if (inst->kind == ValueKind::Call)
+        return std::nullopt;
+      if (inst->kind != ValueKind::Load && inst->kind != ValueKind::Store)
+        continue;
+      auto a = AnalyzeAccess(inst, {iv}, loop);
+      if (!a)
+        return std::nullopt;
+      res.push_back(*a);
+    }
+  return res;
+}
+
+// whether running trip t of second right after trip t of first keeps every
+// dependence, which fails if second touches memory first writes in a later trip
+static bool IsFusionLegal(const vector<AccessPattern> &first, const vector<AccessPattern> &second, int step)
+{
+  for (auto &a : first)
+    for (auto &b : second)
+    {
+      if (!a.isStore && !b.isStore)
+        continue;
+      auto dirs = Dependence(a, b, {step});
+      if (dirs && ((*dirs)[0] & kDirLt))
+        return false;
+    }
+  return true;
+}
+
+// run the body of second after the body of first in the loop of first, which then
+// leaves to the exit of second
+static void Fuse(Loop *first, Loop *second, const LoopControl &fc, const LoopControl &sc)
+{
+  auto h1 = first->header, h2 = second->header;
+  auto ph1 = first->preheader(), ph2 = second->preheader();
+  auto latch1 = first->latches()[0], latch2 = second->latches()[0];
+  auto exit = second->exitBlocks()[0];
+  auto &m = *h1->parent->parent;
+
+  // what second computes before it starts does not depend on first
+  for (auto it = ph2->insts.begin(); *it != ph2->terminator();)
+  {
+    auto inst = *it++;
+    ph2->remove(inst);
+    ph1->insertBeforeTerminator(inst);
+  }
+  sc.iv.phi->replaceAllUsesWith(fc.iv.phi);
+  h2->erase(sc.iv.phi);
+  ReplacePhiIncoming(h1, latch1, latch2);
+  for (auto phi : Phis(h2))
+  {
+    h2->remove(phi);
+    h1->insts.push_front(phi);
+    phi->parent = h1;
+  }
+  ReplacePhiIncoming(h1, ph2, ph1);
+
+  auto br = h2->terminator();
+  auto body = second->contains(br->blocks[0]) ? br->blocks[0] : br->blocks[1];
+  h2->erase(br);
+  h2->erase(sc.cond);
+  h2->push_back(m.createJump(body));
+  ReplaceSuccessor(latch1, h1, h2);
+  ReplaceSuccessor(latch2, h2, h1);
+  ReplaceSuccessor(h1, ph2, exit);
+  ReplacePhiIncoming(exit, h2, h1);
+}
+
+/**
+ * @brief Loop fusion
+ * @details Two innermost loops, one right after the other and running through the
+ * same values of their induction variables, are merged into one, which saves the
+ * loop control of the second and lets the later passes reuse the values the first
+ * body loaded. The second loop must not use any value of the first and, per the
+ * dependence analysis, touch memory the first writes only in the same or earlier
+ * trips, or write memory the first reads only then. Its header holds only phis and
+ * the loop control, and its values are used after the loops only if they come from
+ * header phis, which are kept.
+ */
+bool LoopFusion(Function &f)
+{
+  bool changed = false;
+  for (bool again = true; again;)
+  {
+    again = false;
+    DominatorTree dt(f);
+    LoopInfo li(f, dt);
+    for (auto second : li.postOrder())
+    {
+      if (!second->subLoops.empty() || !li.insertPreheader(second))
+        continue;
+      auto ph2 = second->preheader();
+      if (ph2->preds.size() != 1 || Size(second) > kMaxFusedSize)
+        continue;
+      auto first = li.loopOf.count(ph2->preds[0]) ? li.loopOf[ph2->preds[0]] : nullptr;
+      if (!first || first->header != ph2->preds[0] || !first->subLoops.empty() ||
+          first->parent != second->parent || !li.insertPreheader(first) ||
+          Size(first) + Size(second) > kMaxFusedSize)
+        continue;
+      auto fc = MatchLoopControl(first, first), sc = MatchLoopControl(second, second);
+      if (!fc || !sc || !SameTrips(*fc, *sc) || second->exitBlocks().size() != 1)
+        continue;
+      // second must not need anything first computes
+      auto fromFirst = [&](Value *inst)
+      {
+        return std::any_of(inst->ops.begin(), inst->ops.end(), [&](Value *op)
+                           { return first->contains(op); });
+      };
+      // the header of second runs once more than its body, which fusion drops
+      auto h2 = second->header;
+      bool independent = second->latches()[0] != h2 &&
+                         std::all_of(h2->insts.begin(), h2->insts.end(), [&](Value *v)
+                                     { return v->kind == ValueKind::Phi || v == sc->cond || v->isTerminator(); });
+      for (auto inst : ph2->insts)
+        independent &= !fromFirst(inst) && (inst->isTerminator() || IsSpeculatable(inst));
+      for (auto bb : second->blocks)
+        for (auto inst : bb->insts)
+        {
+          independent &= !fromFirst(inst);
+          // only the header phis survive as values after the fused loop
+          if (inst->kind != ValueKind::Phi || bb != second->header)
+            independent &= std::all_of(inst->users.begin(), inst->users.end(), [&](Value *u)
+                                       { return second->contains(u); });
+        }
+      if (!independent)
+        continue;
+      auto a1 = Accesses(first, fc->iv.phi), a2 = Accesses(second, sc->iv.phi);
+      if (!a1 || !a2 || !IsFusionLegal(*a1, *a2, fc->step))
+        continue;
+      Fuse(first, second, *fc, *sc);
+      RemoveUnreachableBlocks(f);
+      changed = again = true;
+      break;
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,93 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// loops known to run fewer trips are left to unrolling
+static const int kMinIdiomTrips = 8;
+
+// the routines the backend emits for runs of words, they take the destination, the
+// value or the source, and the number of words
+static const string kFillRoutine = "@__fill_words", kCopyRoutine = "@__copy_words";
+
+// the declaration of a routine, added in front of the other functions on first use,
+// nullptr if the program defines a function of that name itself
+static Function *Routine(Module &m, const string &name, const Type *second)
+{
+  if (auto f = m.getFunction(name))
+    return f->isDecl() ? f : nullptr;
+  auto f = m.newFunction(name, Type::getUnit());
+  f->paramTys = {Type::getPointer(Type::getInt32()), second, Type::getInt32()};
+  std::rotate(m.funcs.begin(), m.funcs.end() - 1, m.funcs.end());
+  return f;
+}
+
+// a copy of v computed at the end of at, with the induction variable at its start
+static Value *AtStart(Value *v, Loop *loop, const InductionVar &iv, BasicBlock *at, map<Value *, Value *> &vmap)
+{
+  if (v == iv.phi)
+    return iv.init;
+  if (!loop->contains(v))
+    return v;
+  if (vmap.count(v))
+    return vmap[v];
+  auto c = at->parent->parent->create(v->kind, v->ty);
+  c->op = v->op;
+  for (auto op : v->ops)
+    c->addOperand(AtStart(op, loop, iv, at, vmap));
+  at->insertBeforeTerminator(c);
+  return vmap[v] = c;
+}
+
+/**
+ * @brief Loop idiom recognition
+ * @details An innermost loop whose body only fills an array with an invariant value
+ * or copies one array into another, one word after the other with increasing
+ * addresses, becomes a single call to a routine of the backend, which handles
+ * several words per trip. The addresses of the first words are computed in the
+ * preheader with the induction variable at its start, and the trip count gives the
+ * number of words. The loop is left without side effects for ClosedFormLoops.
+ */
+bool LoopIdiom(Function &f)
+{
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  ScalarEvolution se;
+  auto &m = *f.parent;
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    if (!loop->subLoops.empty() || loop->blocks.size() != 2 || !li.insertPreheader(loop))
+      continue;
+    auto c = MatchLoopControl(loop, loop);
+    if (!c)
+      continue;
+    // the header may only hold the loop control, values of the body die with it
+    auto h = loop->header, body = loop->blocks[1];
+    if (std::any_of(h->insts.begin(), h->insts.end(), [&](Value *v)
+                    { return v != c->iv.phi && v != c->cond && !v->isTerminator(); }))
+      continue;
+    vector<Value *> insts;
+    for (auto inst : body->insts)
+      if (!inst->isTerminator() && inst != c->iv.next)
+        insts.push_back(inst);
+    auto idiom = MatchMemoryIdiom(insts, loop, c->iv.phi, c->step);
+    int64_t trips;
+    if (!idiom || idiom->stride < 0 || (se.constantTripCount(loop, trips) && trips < kMinIdiomTrips))
+      continue;
+    auto routine = idiom->load ? Routine(m, kCopyRoutine, Type::getPointer(Type::getInt32()))
+                               : Routine(m, kFillRoutine, Type::getInt32());
+    auto ph = loop->preheader();
+    auto k = routine ? se.expandTripCount(loop, ph) : nullptr;
+    if (!k)
+      continue;
+    map<Value *, Value *> vmap;
+    auto dest = AtStart(idiom->store->ops[1], loop, c->iv, ph, vmap);
+    auto second = idiom->load ? AtStart(idiom->load->ops[0], loop, c->iv, ph, vmap) : idiom->store->ops[0];
+    ph->insertBeforeTerminator(m.createCall(routine, {dest, second, k}));
+    body->erase(idiom->store);
+    if (idiom->load)
+      body->erase(idiom->load);
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,210 @@
+#include "Analysis.hpp"
+#include <algorithm>
+#include <climits>
+#include <functional>
+
+BasicBlock *Loop::preheader() const
+{
+  BasicBlock *res = nullptr;
+  for (auto p : header->preds)
+  {
+    if (contains(p))
+      continue;
+    if (res)
+      return nullptr;
+    res = p;
+  }
+  if (res && res->successors().size() != 1)
+    return nullptr;
+  return res;
+}
+
+vector<BasicBlock *> Loop::latches() const
+{
+  vector<BasicBlock *> res;
+  for (auto p : header->preds)
+    if (contains(p))
+      res.push_back(p);
+  return res;
+}
+
+vector<BasicBlock *> Loop::exitingBlocks() const
+{
+  vector<BasicBlock *> res;
+  for (auto bb : blocks)
+    for (auto s : bb->successors())
+      if (!contains(s))
+      {
+        res.push_back(bb);
+        break;
+      }
+  return res;
+}
+
+vector<BasicBlock *> Loop::exitBlocks() const
+{
+  vector<BasicBlock *> res;
+  for (auto bb : blocks)
+    for (auto s : bb->successors())
+      if (!contains(s) && std::find(res.begin(), res.end(), s) == res.end())
+        res.push_back(s);
+  return res;
+}
+
+LoopInfo::LoopInfo(Function &f, DominatorTree &dt) : _f(f)
+{
+  unordered_map<BasicBlock *, int> order;
+  for (size_t i = 0; i < dt.rpo.size(); ++i)
+    order[dt.rpo[i]] = i;
+  for (auto h : dt.rpo)
+  {
+    vector<BasicBlock *> work;
+    for (auto p : h->preds)
+      if (dt.dominates(h, p))
+        work.push_back(p);
+    if (work.empty())
+      continue;
+    _loops.emplace_back(std::make_unique<Loop>());
+    auto loop = _loops.back().get();
+    loop->header = h;
+    loop->blockSet.insert(h);
+    // walk backwards from the latches until the header
+    while (!work.empty())
+    {
+      auto bb = work.back();
+      work.pop_back();
+      if (!loop->blockSet.insert(bb).second)
+        continue;
+      for (auto p : bb->preds)
+        if (dt.reachable(p))
+          work.push_back(p);
+    }
+    loop->blocks.assign(loop->blockSet.begin(), loop->blockSet.end());
+    std::sort(loop->blocks.begin(), loop->blocks.end(), [&](BasicBlock *a, BasicBlock *b)
+              { return order[a] < order[b]; });
+  }
+  // the parent of a loop is the smallest other loop containing its header
+  for (auto &l : _loops)
+  {
+    for (auto &o : _loops)
+      if (o != l && o->contains(l->header) &&
+          (!l->parent || o->blockSet.size() < l->parent->blockSet.size()))
+        l->parent = o.get();
+    if (l->parent)
+      l->parent->subLoops.push_back(l.get());
+    else
+      topLevel.push_back(l.get());
+    for (auto bb : l->blocks)
+      if (!loopOf.count(bb) || loopOf[bb]->blockSet.size() > l->blockSet.size())
+        loopOf[bb] = l.get();
+  }
+}
+
+vector<Loop *> LoopInfo::postOrder() const
+{
+  vector<Loop *> res;
+  std::function<void(Loop *)> visit = [&](Loop *l)
+  {
+    for (auto s : l->subLoops)
+      visit(s);
+    res.push_back(l);
+  };
+  for (auto l : topLevel)
+    visit(l);
+  return res;
+}
+
+void LoopInfo::addBlock(Loop *loop, BasicBlock *bb, BasicBlock *before)
+{
+  if (loop && !loopOf.count(bb))
+    loopOf[bb] = loop;
+  for (; loop; loop = loop->parent)
+  {
+    loop->blockSet.insert(bb);
+    auto pos = std::find(loop->blocks.begin(), loop->blocks.end(), before);
+    loop->blocks.insert(pos, bb);
+  }
+}
+
+BasicBlock *LoopInfo::insertPreheader(Loop *loop)
+{
+  if (auto ph = loop->preheader())
+    return ph;
+  auto h = loop->header;
+  if (h == _f.entry())
+    return nullptr;
+  auto &m = *_f.parent;
+  vector<BasicBlock *> outside;
+  for (auto p : h->preds)
+    if (!loop->contains(p))
+      outside.push_back(p);
+  auto ph = _f.newBlock(h->name + "_preheader");
+  ph->push_back(m.createJump(h));
+  for (auto phi : Phis(h))
+  {
+    // merge the values flowing in from outside the loop
+    auto merged = m.createPhi(phi->ty);
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (!loop->contains(phi->blocks[i]))
+      {
+        merged->addOperand(phi->ops[i]);
+        merged->blocks.push_back(phi->blocks[i]);
+      }
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (!loop->contains(phi->blocks[i]))
+      {
+        phi->removeOperand(i);
+        phi->blocks.erase(phi->blocks.begin() + i);
+        --i;
+      }
+    Value *in = merged;
+    if (merged->ops.size() == 1)
+    {
+      in = merged->ops[0];
+      merged->dropOperands();
+    }
+    else
+    {
+      ph->insts.push_front(merged);
+      merged->parent = ph;
+    }
+    phi->addOperand(in);
+    phi->blocks.push_back(ph);
+  }
+  for (auto p : outside)
+    ReplaceSuccessor(p, h, ph);
+  _f.buildCFG();
+  addBlock(loop->parent, ph, h);
+  return ph;
+}
+
+vector<InductionVar> FindInductionVars(Loop *loop)
+{
+  vector<InductionVar> res;
+  auto h = loop->header;
+  auto ph = loop->preheader();
+  if (!ph || h->preds.size() != 2)
+    return res;
+  auto &m = *h->parent->parent;
+  for (auto phi : Phis(h))
+  {
+    if (!phi->ty->isInt())
+      continue;
+    InductionVar iv{phi, nullptr, nullptr, nullptr};
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      (phi->blocks[i] == ph ? iv.init : iv.next) = phi->ops[i];
+    auto next = iv.next;
+    if (!iv.init || !next || next->kind != ValueKind::Binary || !loop->contains(next))
+      continue;
+    auto l = next->ops[0], r = next->ops[1];
+    if (next->op == BinaryOp::Add && l == phi && loop->isInvariant(r))
+      iv.step = r;
+    else if (next->op == BinaryOp::Add && r == phi && loop->isInvariant(l))
+      iv.step = l;
+    else if (next->op == BinaryOp::Sub && l == phi && r->kind == ValueKind::Integer && r->imm != INT_MIN)
+      iv.step = m.getInt(-r->imm);
+    if (iv.step)
+      res.push_back(iv);
+  }
+  return res;
+}
@@ -0,0 +1,101 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+// accesses advancing by at most this many bytes per trip stay within a cache line
+static const int kNearStride = 4;
+
+// exchange start, step and bound of the two loops, so that each induction variable
+// now runs through the values of the other
+static void SwapControl(Loop *outer, LoopControl &oc, LoopControl &ic)
+{
+  auto swapIn = [](Value *phi, Value *from, Value *to)
+  {
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (phi->ops[i] == from)
+        phi->setOperand(i, to);
+  };
+  swapIn(oc.iv.phi, oc.iv.init, ic.iv.init);
+  swapIn(ic.iv.phi, ic.iv.init, oc.iv.init);
+  auto &m = *outer->header->parent->parent;
+  auto setNext = [&](const LoopControl &c, int step)
+  {
+    c.iv.next->op = BinaryOp::Add;
+    c.iv.next->setOperand(0, c.iv.phi);
+    c.iv.next->setOperand(1, m.getInt(step));
+  };
+  setNext(oc, ic.step);
+  setNext(ic, oc.step);
+  auto setCond = [](const LoopControl &c, BinaryOp op, size_t pos, Value *bound)
+  {
+    c.cond->op = op;
+    c.cond->setOperand(pos, c.iv.phi);
+    c.cond->setOperand(1 - pos, bound);
+  };
+  auto op = oc.cond->op;
+  setCond(oc, ic.cond->op, ic.pos, ic.bound);
+  setCond(ic, op, oc.pos, oc.bound);
+}
+
+/**
+ * @brief Loop interchange
+ * @details Arrays are stored row major, so a nest whose inner loop walks down a column
+ * touches a new cache line on every trip. A perfect nest of two loops with
+ * rectangular bounds is swapped when more of the accesses in its body advance by a
+ * small stride in the outer loop than in the inner one. The dependence analysis
+ * must show that no dependence runs forward in one loop and backward in the other.
+ * Sums carried through both loops are fine as integer addition does not care for
+ * the order. The loops keep their blocks: the induction variables exchange their
+ * start, step and bound, and the body their uses.
+ */
+bool LoopInterchange(Function &f)
+{
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    if (loop->subLoops.size() != 1 || !loop->subLoops[0]->subLoops.empty())
+      continue;
+    auto nest = MatchPerfectNest(li, loop);
+    if (!nest || !IsInterchangeLegal(*nest))
+      continue;
+    auto &[outer, inner, oc, ic, sunk, ivs, steps, accesses] = *nest;
+    int nearOuter = 0, nearInner = 0;
+    for (auto &a : accesses)
+    {
+      nearOuter += std::abs(a.stride(0, oc.step)) <= kNearStride;
+      nearInner += std::abs(a.stride(1, ic.step)) <= kNearStride;
+    }
+    if (nearOuter <= nearInner)
+      continue;
+
+    auto h = inner->header;
+    auto pos = std::find_if(h->insts.begin(), h->insts.end(), [](Value *v)
+                            { return v->kind != ValueKind::Phi; });
+    for (auto inst : sunk)
+    {
+      inst->parent->remove(inst);
+      h->insertBefore(*pos, inst);
+    }
+    vector<std::pair<Value *, size_t>> outerUses, innerUses;
+    for (auto bb : inner->blocks)
+      for (auto inst : bb->insts)
+        for (size_t i = 0; i < inst->ops.size(); ++i)
+          if (inst != ic.cond && inst != ic.iv.next)
+          {
+            if (inst->ops[i] == oc.iv.phi)
+              outerUses.emplace_back(inst, i);
+            else if (inst->ops[i] == ic.iv.phi)
+              innerUses.emplace_back(inst, i);
+          }
+    for (auto [inst, i] : outerUses)
+      inst->setOperand(i, ic.iv.phi);
+    for (auto [inst, i] : innerUses)
+      inst->setOperand(i, oc.iv.phi);
+    SwapControl(outer, oc, ic);
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,196 @@
+#include "Analysis.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+std::optional<LoopControl> MatchLoopControl(Loop *loop, Loop *outer)
+{
+  auto h = loop->header;
+  auto br = h->terminator();
+  auto exiting = loop->exitingBlocks();
+  if (loop->latches().size() != 1 || exiting.size() != 1 || exiting[0] != h || br->kind != ValueKind::Branch)
+    return std::nullopt;
+  auto cond = br->ops[0];
+  if (cond->kind != ValueKind::Binary || cond->parent != h || cond->users.size() != 1 || cond->ops[0] == cond->ops[1])
+    return std::nullopt;
+  for (auto &iv : FindInductionVars(loop))
+  {
+    size_t pos = cond->ops[0] == iv.phi ? 0 : 1;
+    auto bound = cond->ops[1 - pos];
+    if (cond->ops[pos] != iv.phi || iv.step->kind != ValueKind::Integer || !iv.step->imm ||
+        !outer->isInvariant(bound) || !outer->isInvariant(iv.init) || iv.next->users.size() != 1)
+      continue;
+    return LoopControl{iv, cond, bound, pos, iv.step->imm};
+  }
+  return std::nullopt;
+}
+
+static Value *Incoming(Value *phi, BasicBlock *from)
+{
+  for (size_t i = 0; i < phi->ops.size(); ++i)
+    if (phi->blocks[i] == from)
+      return phi->ops[i];
+  return nullptr;
+}
+
+// whether the other header phis of the nest are sums carried from the outer loop
+// through the inner one, which add up to the same whatever the order of the trips
+static bool OnlyReductions(Loop *outer, Loop *inner, const LoopControl &oc, const LoopControl &ic)
+{
+  auto latch = outer->latches()[0], innerLatch = inner->latches()[0];
+  auto innerPhis = Phis(inner->header);
+  int count = 0;
+  for (auto r1 : Phis(outer->header))
+  {
+    if (r1 == oc.iv.phi)
+      continue;
+    ++count;
+    auto r2 = Incoming(r1, latch);
+    if (!r2 || r2 == ic.iv.phi || std::find(innerPhis.begin(), innerPhis.end(), r2) == innerPhis.end() ||
+        Incoming(r2, inner->preheader()) != r1)
+      return false;
+    auto next = Incoming(r2, innerLatch);
+    if (!next || next->kind != ValueKind::Binary || next->op != BinaryOp::Add || next->users.size() != 1 ||
+        (next->ops[0] == r2) == (next->ops[1] == r2))
+      return false;
+    if (!std::all_of(r2->users.begin(), r2->users.end(), [&](Value *u)
+                     { return u == next || u == r1; }) ||
+        !std::all_of(r1->users.begin(), r1->users.end(), [&](Value *u)
+                     { return u == r2 || !outer->contains(u); }))
+      return false;
+  }
+  return count + 1 == int(innerPhis.size());
+}
+
+// the instructions of the outer loop besides its control and the inner loop, none if
+// one of them has a side effect or is used elsewhere, or if a block around the inner
+// loop branches, as a guard of the inner loop would not run on every trip
+static std::optional<vector<Value *>> OuterOnlyInsts(Loop *outer, Loop *inner, const LoopControl &oc)
+{
+  vector<Value *> res;
+  for (auto bb : outer->blocks)
+  {
+    if (inner->contains(bb))
+      continue;
+    if (bb != outer->header && bb->terminator()->kind == ValueKind::Branch)
+      return std::nullopt;
+    for (auto inst : bb->insts)
+    {
+      if ((inst->kind == ValueKind::Phi && bb == outer->header) || inst->isTerminator() ||
+          inst == oc.cond || inst == oc.iv.next)
+        continue;
+      if (!IsSpeculatable(inst) || !std::all_of(inst->users.begin(), inst->users.end(), [&](Value *u)
+                                                { return inner->contains(u); }))
+        return std::nullopt;
+      res.push_back(inst);
+    }
+  }
+  return res;
+}
+
+std::optional<PerfectNest> MatchPerfectNest(LoopInfo &li, Loop *outer)
+{
+  if (outer->subLoops.size() != 1)
+    return std::nullopt;
+  auto inner = outer->subLoops[0];
+  if (!li.insertPreheader(outer) || !li.insertPreheader(inner))
+    return std::nullopt;
+  auto oc = MatchLoopControl(outer, outer), ic = MatchLoopControl(inner, outer);
+  if (!oc || !ic || inner->exitBlocks() != outer->latches() ||
+      !OnlyReductions(outer, inner, *oc, *ic))
+    return std::nullopt;
+  auto outerOnly = OuterOnlyInsts(outer, inner, *oc);
+  if (!outerOnly)
+    return std::nullopt;
+  // besides the outer control, only the inner loop and what moves into it may use the
+  // outer induction variable, and the values of both must not matter after the loops
+  if (std::any_of(oc->iv.phi->users.begin(), oc->iv.phi->users.end(), [&](Value *u)
+                  { return u != oc->cond && u != oc->iv.next && !inner->contains(u) &&
+                           std::find(outerOnly->begin(), outerOnly->end(), u) == outerOnly->end(); }) ||
+      std::any_of(ic->iv.phi->users.begin(), ic->iv.phi->users.end(), [&](Value *u)
+                  { return !inner->contains(u); }))
+    return std::nullopt;
+
+  PerfectNest nest{outer, inner, *oc, *ic, *outerOnly, {oc->iv.phi, ic->iv.phi}, {oc->step, ic->step}, {}};
+  // loops inside the inner one contribute their induction variables to the subscripts
+  vector<Loop *> work(inner->subLoops.begin(), inner->subLoops.end());
+  for (size_t k = 0; k < work.size(); ++k)
+  {
+    auto loop = work[k];
+    work.insert(work.end(), loop->subLoops.begin(), loop->subLoops.end());
+    if (!li.insertPreheader(loop))
+      continue;
+    for (auto &iv : FindInductionVars(loop))
+      if (iv.step->kind == ValueKind::Integer && iv.step->imm)
+      {
+        nest.ivs.push_back(iv.phi);
+        nest.steps.push_back(iv.step->imm);
+      }
+  }
+  for (auto bb : inner->blocks)
+    for (auto inst : bb->insts)
+    {
+      if (inst->kind == ValueKind::Call)
+        return std::nullopt;
+      if (inst->kind != ValueKind::Load && inst->kind != ValueKind::Store)
+        continue;
+      auto a = AnalyzeAccess(inst, nest.ivs, outer);
+      if (!a)
+        return std::nullopt;
+      nest.accesses.push_back(*a);
+    }
+  return nest;
+}
+
+bool IsInterchangeLegal(const PerfectNest &nest)
+{
+  auto &accesses = nest.accesses;
+  for (size_t a = 0; a < accesses.size(); ++a)
+    for (size_t b = a; b < accesses.size(); ++b)
+    {
+      if (!accesses[a].isStore && !accesses[b].isStore)
+        continue;
+      auto dirs = Dependence(accesses[a], accesses[b], nest.steps);
+      if (!dirs)
+        continue;
+      // the loops further in come after both, so their order is kept
+      auto outer = (*dirs)[0], inner = (*dirs)[1];
+      if (((outer & kDirLt) && (inner & kDirGt)) || ((outer & kDirGt) && (inner & kDirLt)))
+        return false;
+    }
+  return true;
+}
+
+std::optional<MemoryIdiom> MatchMemoryIdiom(const vector<Value *> &insts, Loop *loop, Value *iv, int step)
+{
+  MemoryIdiom res{};
+  for (auto inst : insts)
+  {
+    auto &slot = inst->kind == ValueKind::Store ? res.store : res.load;
+    if (inst->kind == ValueKind::Store || inst->kind == ValueKind::Load)
+    {
+      if (slot)
+        return std::nullopt;
+      slot = inst;
+    }
+    else if (!IsSpeculatable(inst))
+      return std::nullopt;
+  }
+  if (!res.store || (res.load ? res.store->ops[0] != res.load : !loop->isInvariant(res.store->ops[0])))
+    return std::nullopt;
+  // one element of 4 bytes after the other, from and to distinct arrays
+  vector<AccessPattern> accesses;
+  for (auto inst : {res.store, res.load})
+  {
+    if (!inst)
+      continue;
+    auto a = AnalyzeAccess(inst, {iv}, loop);
+    if (!a || std::abs(a->stride(0, step)) != 4)
+      return std::nullopt;
+    accesses.push_back(*a);
+  }
+  if (res.load && (accesses[0].stride(0, step) != accesses[1].stride(0, step) ||
+                   Dependence(accesses[0], accesses[1], {step})))
+    return std::nullopt;
+  res.stride = accesses[0].stride(0, step);
+  return res;
+}
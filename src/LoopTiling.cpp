@@ -0,0 +1,218 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+// the data a tile touches should fit into this many bytes, half of a 32 KiB L1 data
+// cache, leaving room for everything else
+static const int64_t kCacheBytes = 16 * 1024;
+static const int kLineBytes = 64;
+// loops whose trip count is unknown are assumed to run this often
+static const int64_t kAssumedTrips = 1024;
+// shorter tiles do not make up for the extra loop around them
+static const int kMinTileTrips = 8;
+
+static bool DependsOn(const AccessPattern &a, size_t iv)
+{
+  return std::any_of(a.subscripts.begin(), a.subscripts.end(), [&](const Subscript &s)
+                     { return s.coefs[iv] != 0; });
+}
+
+// the bytes an access touches over all trips of the loops with induction variables
+// ivs[1...], a whole cache line per trip unless one of them walks along a row
+static int64_t Footprint(const PerfectNest &nest, const AccessPattern &a, const vector<int64_t> &trips)
+{
+  int64_t bytes = 1;
+  bool dense = false;
+  for (size_t i = 1; i < nest.ivs.size(); ++i)
+    if (DependsOn(a, i))
+    {
+      bytes = std::min(bytes * trips[i], kCacheBytes * kCacheBytes);
+      dense |= std::abs(a.stride(i, nest.steps[i])) <= 4;
+    }
+  return bytes * (dense ? 4 : kLineBytes);
+}
+
+// whether the next trip of the outer loop touches the same cache lines again, and
+// the loops inside touch more than a single element
+static bool HasOuterReuse(const PerfectNest &nest, const AccessPattern &a)
+{
+  if (std::abs(a.stride(0, nest.steps[0])) >= kLineBytes)
+    return false;
+  for (size_t i = 1; i < nest.ivs.size(); ++i)
+    if (DependsOn(a, i))
+      return true;
+  return false;
+}
+
+// how many trips of the inner loop go into a tile, 0 if tiling does not pay off
+static int TileTrips(LoopInfo &li, const PerfectNest &nest)
+{
+  if (std::none_of(nest.accesses.begin(), nest.accesses.end(), [&](const AccessPattern &a)
+                   { return HasOuterReuse(nest, a); }))
+    return 0;
+  ScalarEvolution se;
+  vector<int64_t> trips;
+  for (auto iv : nest.ivs)
+  {
+    int64_t count;
+    auto loop = li.loopOf[iv->parent];
+    trips.push_back(se.constantTripCount(loop, count) ? std::max<int64_t>(count, 1) : kAssumedTrips);
+  }
+  if (int size = GetOptConfig().tileSize)
+    return size < trips[1] ? size : 0;
+  int64_t bytes = 0;
+  for (auto &a : nest.accesses)
+    bytes += Footprint(nest, a, trips);
+  if (bytes <= kCacheBytes)
+    return 0;
+  int64_t tile = kCacheBytes * trips[1] / bytes;
+  if (tile < kMinTileTrips || tile >= trips[1])
+    return 0;
+  int res = 1;
+  while (res * 2 <= tile)
+    res *= 2;
+  return res;
+}
+
+// whether the inner loop runs while its variable stays below, or above for a
+// negative step, its bound, so that a tile can stop it early
+static bool IsMonotoneTest(const LoopControl &c)
+{
+  auto op = c.pos == 0 ? c.cond->op : SwappedCompare(c.cond->op);
+  if (c.step > 0)
+    return op == BinaryOp::Lt || op == BinaryOp::Le;
+  return op == BinaryOp::Gt || op == BinaryOp::Ge;
+}
+
+// strip mine the inner loop into tiles of tile trips and run the outer loop once per tile
+static void Tile(LoopInfo &li, const PerfectNest &nest, int tile)
+{
+  auto &[outer, inner, oc, ic, outerOnly, ivs, steps, accesses] = nest;
+  auto h = outer->header, ph = outer->preheader();
+  auto exit = outer->exitBlocks()[0];
+  auto &f = *h->parent;
+  auto &m = *f.parent;
+  int span = tile * ic.step;
+
+  // the tile loop steps through the first values of the tiles, and stops once the
+  // next one wraps around
+  auto th = f.newBlock(inner->header->name + "_tile");
+  auto body = f.newBlock(inner->header->name + "_tile_body");
+  auto tl = f.newBlock(inner->header->name + "_tile_next");
+  auto start = m.createPhi(Type::getInt32());
+  auto valid = m.createPhi(Type::getInt32());
+  th->push_back(start);
+  th->push_back(valid);
+  auto test = m.createBinary(ic.cond->op, ic.cond->ops[0], ic.cond->ops[1]);
+  test->setOperand(ic.pos, start);
+  th->push_back(test);
+  auto go = m.createBinary(BinaryOp::And, test, valid);
+  th->push_back(go);
+  th->push_back(m.createBranch(go, body, exit));
+  body->push_back(m.createJump(h));
+  auto next = m.createBinary(BinaryOp::Add, start, m.getInt(span));
+  tl->push_back(next);
+  auto forward = m.createBinary(span > 0 ? BinaryOp::Gt : BinaryOp::Lt, next, start);
+  tl->push_back(forward);
+  tl->push_back(m.createJump(th));
+  start->addOperand(ic.iv.init);
+  start->blocks.push_back(ph);
+  start->addOperand(next);
+  start->blocks.push_back(tl);
+  valid->addOperand(m.getInt(1));
+  valid->blocks.push_back(ph);
+  valid->addOperand(forward);
+  valid->blocks.push_back(tl);
+
+  // sums carried through the nest are carried through the tile loop too
+  for (auto phi : Phis(h))
+  {
+    if (phi == oc.iv.phi)
+      continue;
+    vector<std::pair<Value *, size_t>> after;
+    for (auto u : phi->users)
+      if (!outer->contains(u))
+        for (size_t i = 0; i < u->ops.size(); ++i)
+          if (u->ops[i] == phi)
+            after.emplace_back(u, i);
+    auto sum = m.createPhi(phi->ty);
+    th->insts.push_front(sum);
+    sum->parent = th;
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (phi->blocks[i] == ph)
+      {
+        sum->addOperand(phi->ops[i]);
+        phi->setOperand(i, sum);
+      }
+    sum->blocks.push_back(ph);
+    sum->addOperand(phi);
+    sum->blocks.push_back(tl);
+    for (auto [u, i] : after)
+      u->setOperand(i, sum);
+  }
+  ReplacePhiIncoming(h, ph, body);
+  ReplacePhiIncoming(exit, h, th);
+  ReplaceSuccessor(h, exit, tl);
+  ReplaceSuccessor(ph, h, th);
+
+  // the inner loop starts at the tile and leaves it after tile trips
+  auto iph = inner->preheader();
+  for (size_t i = 0; i < ic.iv.phi->ops.size(); ++i)
+    if (ic.iv.phi->blocks[i] == iph)
+      ic.iv.phi->setOperand(i, start);
+  auto offset = m.createBinary(BinaryOp::Sub, ic.iv.phi, start);
+  auto inTile = m.createBinary(span > 0 ? BinaryOp::Lt : BinaryOp::Gt, offset, m.getInt(span));
+  auto both = m.createBinary(BinaryOp::And, ic.cond, inTile);
+  auto ih = inner->header;
+  ih->insertAfter(ic.cond, offset);
+  ih->insertAfter(offset, inTile);
+  ih->insertAfter(inTile, both);
+  ih->terminator()->setOperand(0, both);
+
+  for (auto bb : {th, body, tl})
+    li.addBlock(outer->parent, bb, h);
+  f.buildCFG();
+}
+
+/**
+ * @brief Loop tiling
+ * @details A perfect nest whose outer loop comes back to the data the inner loops
+ * touched, like the rows of B in C[i][j] += A[i][k] * B[k][j] over i, k, j, loses it
+ * from the cache between trips once that data is larger than the cache. The inner
+ * loop is then cut into tiles, a new loop around the outer one steps through them,
+ * and each tile is small enough for the cache to hold its data for all trips of the
+ * outer loop. The tile size comes from -tile-size, or from the footprint of the
+ * accesses with the trip counts known or assumed. Running the inner trips of a
+ * tile for all outer trips first needs the same dependences to hold as swapping
+ * the two loops does.
+ */
+bool LoopTiling(Function &f)
+{
+  if (GetOptConfig().tileSize == 1)
+    return false;
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  set<Loop *> tiled;
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    // the tile loop is not known to LoopInfo, so the loops around it are left alone
+    if (std::any_of(loop->subLoops.begin(), loop->subLoops.end(), [&](Loop *l)
+                    { return tiled.count(l); }))
+    {
+      tiled.insert(loop);
+      continue;
+    }
+    auto nest = MatchPerfectNest(li, loop);
+    if (!nest || !IsMonotoneTest(nest->ic) || !IsInterchangeLegal(*nest))
+      continue;
+    int tile = TileTrips(li, *nest);
+    if (!tile || std::abs(int64_t(tile) * nest->ic.step) > kCacheBytes)
+      continue;
+    Tile(li, *nest, tile);
+    tiled.insert(loop);
+    changed = true;
+  }
+  return changed;
+}
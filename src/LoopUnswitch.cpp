@@ -0,0 +1,169 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// only loops of at most this many instructions are copied
+static const int kMaxUnswitchSize = 120;
+// no function grows by more than this many instructions through unswitching
+static const int kMaxGrowth = 1000;
+
+static int Size(Loop *loop)
+{
+  int size = 0;
+  for (auto bb : loop->blocks)
+    size += bb->insts.size();
+  return size;
+}
+
+// a branch inside the loop on a loop invariant condition which stays in the loop
+// both ways
+static Value *FindInvariantBranch(Loop *loop)
+{
+  for (auto bb : loop->blocks)
+  {
+    auto br = bb->terminator();
+    if (br->kind != ValueKind::Branch || br->ops[0]->kind == ValueKind::Integer ||
+        !loop->isInvariant(br->ops[0]) || br->blocks[0] == br->blocks[1] ||
+        !loop->contains(br->blocks[0]) || !loop->contains(br->blocks[1]))
+      continue;
+    return br;
+  }
+  return nullptr;
+}
+
+// the only exit block of the loop if all of its predecessors are in the loop
+static BasicBlock *DedicatedExit(Loop *loop)
+{
+  auto exits = loop->exitBlocks();
+  if (exits.size() != 1 || !std::all_of(exits[0]->preds.begin(), exits[0]->preds.end(), [&](BasicBlock *p)
+                                        { return loop->contains(p); }))
+    return nullptr;
+  return exits[0];
+}
+
+// turn the branch into a jump to its successor succ
+static void FoldBranch(Value *br, size_t succ)
+{
+  auto &m = *br->parent->parent->parent;
+  auto bb = br->parent;
+  auto target = br->blocks[succ];
+  RemovePhiIncoming(br->blocks[1 - succ], bb);
+  bb->erase(br);
+  bb->push_back(m.createJump(target));
+}
+
+// copy the loop, run the original when the condition of br holds and the copy
+// otherwise, and drop the branch from both
+static void Unswitch(Loop *loop, Value *br, BasicBlock *exit)
+{
+  auto h = loop->header, ph = loop->preheader();
+  auto &f = *h->parent;
+  auto &m = *f.parent;
+  auto cond = br->ops[0];
+  vector<BasicBlock *> exiting;
+  for (auto p : exit->preds)
+    if (std::find(exiting.begin(), exiting.end(), p) == exiting.end())
+      exiting.push_back(p);
+
+  // the values of the loop used after it, other than by the phis of the exit
+  vector<std::pair<Value *, vector<std::pair<Value *, size_t>>>> liveOut;
+  for (auto bb : loop->blocks)
+    for (auto inst : bb->insts)
+    {
+      vector<std::pair<Value *, size_t>> uses;
+      for (auto u : inst->users)
+        if (!loop->contains(u) && !(u->kind == ValueKind::Phi && u->parent == exit))
+          for (size_t i = 0; i < u->ops.size(); ++i)
+            if (u->ops[i] == inst)
+              uses.emplace_back(u, i);
+      if (!uses.empty())
+        liveOut.emplace_back(inst, uses);
+    }
+
+  map<Value *, Value *> vmap;
+  auto blocks = CloneBlocks(loop->blocks, f, vmap);
+  map<BasicBlock *, BasicBlock *> bmap;
+  for (size_t i = 0; i < blocks.size(); ++i)
+    bmap[loop->blocks[i]] = blocks[i];
+  auto mapped = [&](Value *v)
+  {
+    auto it = vmap.find(v);
+    return it != vmap.end() ? it->second : v;
+  };
+
+  // the exit is now also entered from the copy
+  for (auto phi : Phis(exit))
+  {
+    auto n = phi->ops.size();
+    for (size_t i = 0; i < n; ++i)
+      if (bmap.count(phi->blocks[i]))
+      {
+        phi->addOperand(mapped(phi->ops[i]));
+        phi->blocks.push_back(bmap[phi->blocks[i]]);
+      }
+  }
+  for (auto &[inst, uses] : liveOut)
+  {
+    auto phi = m.createPhi(inst->ty);
+    exit->insts.push_front(phi);
+    phi->parent = exit;
+    for (auto p : exiting)
+    {
+      phi->addOperand(inst);
+      phi->blocks.push_back(p);
+      phi->addOperand(vmap[inst]);
+      phi->blocks.push_back(bmap[p]);
+    }
+    for (auto [u, i] : uses)
+      u->setOperand(i, phi);
+  }
+
+  auto jump = ph->terminator();
+  ph->erase(jump);
+  ph->push_back(m.createBranch(cond, h, bmap[h]));
+  FoldBranch(vmap[br], 1);
+  FoldBranch(br, 0);
+  f.buildCFG();
+}
+
+/**
+ * @brief Loop unswitching
+ * @details An if inside a loop whose condition does not change in the loop tests it
+ * on every trip. The loop is copied instead and the test made once before it: the
+ * original runs when the condition holds and the copy when it does not, and each
+ * only keeps its own side of the branch, which SimplifyCFG and the other passes can
+ * then clean up independently. Outer loops are tried first so that the test ends up
+ * as far out as possible. A loop is only copied if it is small, leaves through a
+ * single exit and the function stays within a growth budget. The values computed in
+ * the loop and used after it are merged by phis at the exit.
+ */
+bool LoopUnswitch(Function &f)
+{
+  int growth = 0;
+  bool changed = false;
+  for (bool again = true; again;)
+  {
+    again = false;
+    DominatorTree dt(f);
+    LoopInfo li(f, dt);
+    auto loops = li.postOrder();
+    for (auto it = loops.rbegin(); it != loops.rend() && !again; ++it)
+    {
+      auto loop = *it;
+      int size = Size(loop);
+      if (size > kMaxUnswitchSize || growth + size > kMaxGrowth)
+        continue;
+      auto br = FindInvariantBranch(loop);
+      if (!br || !li.insertPreheader(loop))
+        continue;
+      auto exit = DedicatedExit(loop);
+      if (!exit)
+        continue;
+      Unswitch(loop, br, exit);
+      RemoveUnreachableBlocks(f);
+      growth += size;
+      changed = again = true;
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,159 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// an alloc can be promoted if it is a scalar which is only loaded from and stored to
+static bool Promotable(Value *alloc)
+{
+  if (!alloc->ty->base->isInt() && !alloc->ty->base->isPointer())
+    return false;
+  for (auto u : alloc->users)
+  {
+    if (u->kind == ValueKind::Load)
+      continue;
+    if (u->kind == ValueKind::Store && u->ops[1] == alloc && u->ops[0] != alloc)
+      continue;
+    return false;
+  }
+  return true;
+}
+
+bool Mem2Reg(Function &f)
+{
+  auto &m = *f.parent;
+  vector<Value *> allocs;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (inst->kind == ValueKind::Alloc && Promotable(inst))
+        allocs.push_back(inst);
+  if (allocs.empty())
+    return false;
+
+  DominatorTree dt(f);
+  auto df = dt.frontier();
+  unordered_map<Value *, int> index;
+  for (size_t i = 0; i < allocs.size(); ++i)
+    index[allocs[i]] = i;
+
+  // place phis on the iterated dominance frontier of the stores
+  unordered_map<Value *, Value *> phiOf;
+  for (auto alloc : allocs)
+  {
+    vector<BasicBlock *> work;
+    set<BasicBlock *> placed, queued;
+    for (auto u : alloc->users)
+      if (u->kind == ValueKind::Store && queued.insert(u->parent).second)
+        work.push_back(u->parent);
+    while (!work.empty())
+    {
+      auto bb = work.back();
+      work.pop_back();
+      for (auto d : df[bb])
+      {
+        if (!placed.insert(d).second)
+          continue;
+        auto phi = m.createPhi(alloc->ty->base);
+        phi->parent = d;
+        d->insts.push_front(phi);
+        phiOf[phi] = alloc;
+        if (queued.insert(d).second)
+          work.push_back(d);
+      }
+    }
+  }
+
+  // rename along the dominator tree
+  vector<Value *> cur;
+  for (auto alloc : allocs)
+    cur.push_back(alloc->ty->base->isInt() ? m.getInt(0) : m.getUndef(alloc->ty->base));
+  vector<Value *> dead;
+  struct Frame
+  {
+    BasicBlock *bb;
+    vector<Value *> saved;
+    size_t child;
+  };
+  vector<Frame> stack;
+  auto enter = [&](BasicBlock *bb)
+  {
+    stack.push_back({bb, cur, 0});
+    for (auto inst : bb->insts)
+    {
+      if (inst->kind == ValueKind::Phi && phiOf.count(inst))
+      {
+        cur[index[phiOf[inst]]] = inst;
+      }
+      else if (inst->kind == ValueKind::Load && index.count(inst->ops[0]))
+      {
+        inst->replaceAllUsesWith(cur[index[inst->ops[0]]]);
+        dead.push_back(inst);
+      }
+      else if (inst->kind == ValueKind::Store && index.count(inst->ops[1]))
+      {
+        cur[index[inst->ops[1]]] = inst->ops[0];
+        dead.push_back(inst);
+      }
+    }
+    for (auto s : bb->successors())
+      for (auto phi : Phis(s))
+        if (phiOf.count(phi))
+        {
+          phi->addOperand(cur[index[phiOf[phi]]]);
+          phi->blocks.push_back(bb);
+        }
+  };
+  enter(f.entry());
+  while (!stack.empty())
+  {
+    auto &top = stack.back();
+    auto &ch = dt.children[top.bb];
+    if (top.child < ch.size())
+    {
+      enter(ch[top.child++]);
+    }
+    else
+    {
+      cur = top.saved;
+      stack.pop_back();
+    }
+  }
+
+  for (auto inst : dead)
+    inst->parent->erase(inst);
+  for (auto alloc : allocs)
+    alloc->parent->erase(alloc);
+  return true;
+}
+
+void DestructSSA(Function &f)
+{
+  auto &m = *f.parent;
+  vector<Value *> phis;
+  for (auto bb : f.blocks)
+    for (auto phi : Phis(bb))
+      phis.push_back(phi);
+  // every phi gets a stack slot, each predecessor stores the incoming value right
+  // before leaving, and the phi itself becomes a load at the top of its block
+  for (auto phi : phis)
+  {
+    auto bb = phi->parent;
+    auto slot = m.createAlloc(phi->ty);
+    slot->name = "@phi";
+    f.entry()->insts.push_front(slot);
+    slot->parent = f.entry();
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+    {
+      auto v = phi->ops[i];
+      // an undefined pointer needs no store, the slot holds garbage anyway
+      if (v->kind == ValueKind::Undef && !v->ty->isInt())
+        continue;
+      if (v->kind == ValueKind::Undef)
+        v = m.getInt(0);
+      phi->blocks[i]->insertBeforeTerminator(m.createStore(v, slot));
+    }
+    auto load = m.createLoad(slot);
+    bb->insertBefore(phi, load);
+    phi->replaceAllUsesWith(load);
+    bb->erase(phi);
+  }
+}
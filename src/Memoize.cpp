@@ -0,0 +1,156 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// entries of the direct mapped table of each memoized function, a power of two
+static const int kMemoEntries = 1024;
+// only functions of at most this many parameters are memoized, each one is a key
+static const int kMaxMemoParams = 2;
+// the multiplier mixing the first key into the slot of the second
+static const int kMemoHashMul = 31;
+
+/**
+ * @brief Functions whose result only depends on the values of their arguments
+ * @details A pure function takes and returns integers, and its mod/ref summary shows
+ * no I/O and no memory but its own locals. Reading a global counts, as a callee may
+ * change it between two calls, so only globals ConstantGlobals has folded away are
+ * fine.
+ */
+static bool IsPureFunction(Function &f)
+{
+  auto s = GetModRef(&f);
+  return !f.isDecl() && f.retTy->isInt() && s && *s == ModRef() &&
+         std::all_of(f.paramTys.begin(), f.paramTys.end(), [](const Type *ty)
+                     { return ty->isInt(); });
+}
+
+static Value *NewTable(Module &m, const string &name)
+{
+  auto ty = Type::getArray(Type::getInt32(), kMemoEntries);
+  auto g = m.create(ValueKind::GlobalAlloc, Type::getPointer(ty));
+  g->name = name;
+  for (int i = 1; std::any_of(m.globals.begin(), m.globals.end(), [&](Value *o)
+                              { return o->name == g->name; });
+       ++i)
+    g->name = name + "_" + std::to_string(i);
+  g->addOperand(m.getZeroInit(ty));
+  m.globals.push_back(g);
+  return g;
+}
+
+// wrap the body of f into a lookup of its arguments in a fresh table
+static void AddMemoTable(Function &f)
+{
+  auto &m = *f.parent;
+  string base = "@memo_" + f.name.substr(1);
+  vector<Value *> keys;
+  for (size_t i = 0; i < f.params.size(); ++i)
+    keys.push_back(NewTable(m, base + "_key" + std::to_string(i)));
+  auto vals = NewTable(m, base + "_val");
+  auto valid = NewTable(m, base + "_valid");
+
+  // the old entry becomes the body run on a miss, a new entry keeps the allocs
+  auto body = f.entry();
+  body->name = m.uniqueLabel("%memo_miss");
+  auto entry = f.newBlock("%entry");
+  entry->name = "%entry";
+  f.blocks.remove(entry);
+  f.blocks.push_front(entry);
+  for (auto it = body->insts.begin(); it != body->insts.end();)
+  {
+    auto inst = *it++;
+    if (inst->kind != ValueKind::Alloc)
+      continue;
+    body->remove(inst);
+    entry->push_back(inst);
+  }
+
+  // a negative key lands in the table as well, the mask keeps the low bits
+  Value *hash = f.params[0];
+  for (size_t i = 1; i < f.params.size(); ++i)
+  {
+    auto mul = m.createBinary(BinaryOp::Mul, hash, m.getInt(kMemoHashMul));
+    entry->push_back(mul);
+    hash = m.createBinary(BinaryOp::Add, mul, f.params[i]);
+    entry->push_back(hash);
+  }
+  auto slot = m.createBinary(BinaryOp::And, hash, m.getInt(kMemoEntries - 1));
+  entry->push_back(slot);
+  auto load = [&](Value *table, BasicBlock *bb)
+  {
+    auto ptr = m.createGetElemPtr(table, slot);
+    bb->push_back(ptr);
+    auto v = m.createLoad(ptr);
+    bb->push_back(v);
+    return v;
+  };
+
+  auto check = f.newBlock("%memo_check");
+  auto hit = f.newBlock("%memo_hit");
+  entry->push_back(m.createBranch(load(valid, entry), check, body));
+  Value *match = nullptr;
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    auto eq = m.createBinary(BinaryOp::Eq, load(keys[i], check), f.params[i]);
+    check->push_back(eq);
+    if (match)
+    {
+      eq = m.createBinary(BinaryOp::And, match, eq);
+      check->push_back(eq);
+    }
+    match = eq;
+  }
+  check->push_back(m.createBranch(match, hit, body));
+  hit->push_back(m.createRet(load(vals, hit)));
+
+  // the slot is computed in the entry, which dominates every return
+  for (auto bb : f.blocks)
+  {
+    auto ret = bb->terminator();
+    if (bb == hit || !ret || ret->kind != ValueKind::Ret)
+      continue;
+    auto store = [&](Value *v, Value *table)
+    {
+      auto ptr = m.createGetElemPtr(table, slot);
+      bb->insertBefore(ret, ptr);
+      bb->insertBefore(ret, m.createStore(v, ptr));
+    };
+    for (size_t i = 0; i < keys.size(); ++i)
+      store(f.params[i], keys[i]);
+    store(ret->ops[0], vals);
+    store(m.getInt(1), valid);
+  }
+}
+
+/**
+ * @brief Automatic memoization of pure recursive functions
+ * @details Only with -memoize. A pure function calling itself from more than one
+ * place, like the naive Fibonacci, may recompute the same arguments an exponential
+ * number of times. Such a function first looks its arguments up in a direct mapped
+ * table of kMemoEntries slots, a zero initialized global in .bss, and returns the
+ * stored result on a hit. Every return stores its result in the slot, replacing
+ * whatever was there, so the memory used stays fixed however many distinct
+ * arguments there are. Linear recursion is left to TailRecursionElim.
+ */
+bool Memoize(Module &m)
+{
+  if (!GetOptConfig().memoize)
+    return false;
+  ComputeModRef(m);
+  bool changed = false;
+  for (auto &fp : m.funcs)
+  {
+    auto f = fp.get();
+    if (!IsPureFunction(*f))
+      continue;
+    int selfCalls = 0;
+    for (auto bb : f->blocks)
+      for (auto inst : bb->insts)
+        selfCalls += inst->kind == ValueKind::Call && inst->callee == f;
+    if (selfCalls < 2 || f->params.empty() || int(f->params.size()) > kMaxMemoParams)
+      continue;
+    AddMemoTable(*f);
+    changed = true;
+  }
+  return changed;
+}
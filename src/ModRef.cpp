@@ -0,0 +1,123 @@
+#include "Analysis.hpp"
+#include <algorithm>
+
+static unordered_map<Function *, ModRef> &Summaries()
+{
+  static unordered_map<Function *, ModRef> summaries;
+  return summaries;
+}
+
+// the summaries of the library, every function of it does I/O or reads the clock
+// but the routines LoopIdiom calls, which the backend emits
+static ModRef LibrarySummary(const string &name)
+{
+  ModRef s;
+  if (name == "@__fill_words" || name == "@__copy_words")
+  {
+    s.modParams = {0};
+    if (name == "@__copy_words")
+      s.refParams = {1};
+    return s;
+  }
+  s.io = true;
+  if (name == "@getarray")
+    s.modParams = {0};
+  else if (name == "@putarray")
+    s.refParams = {1};
+  else if (name != "@getint" && name != "@getch" && name != "@putint" && name != "@putch" &&
+           name != "@starttime" && name != "@stoptime")
+    s.unknown = true;
+  return s;
+}
+
+// record an access of f to the object obj, as returned by UnderlyingObject
+static void AddAccess(ModRef &s, Function &f, Value *obj, bool mod)
+{
+  if (!obj)
+    s.unknown = true;
+  else if (obj->kind == ValueKind::GlobalAlloc)
+    (mod ? s.modGlobals : s.refGlobals).insert(obj);
+  else if (obj->kind == ValueKind::FuncArg)
+  {
+    size_t i = std::find(f.params.begin(), f.params.end(), obj) - f.params.begin();
+    (mod ? s.modParams : s.refParams).insert(i);
+  }
+  // the locals of f are none of the callers' business
+}
+
+static ModRef Summarize(Function &f)
+{
+  ModRef s;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (inst->kind == ValueKind::Load)
+        AddAccess(s, f, UnderlyingObject(inst->ops[0]), false);
+      else if (inst->kind == ValueKind::Store)
+        AddAccess(s, f, UnderlyingObject(inst->ops[1]), true);
+      else if (inst->kind == ValueKind::Call)
+      {
+        auto &c = Summaries()[inst->callee];
+        s.unknown |= c.unknown;
+        s.io |= c.io;
+        s.refGlobals.insert(c.refGlobals.begin(), c.refGlobals.end());
+        s.modGlobals.insert(c.modGlobals.begin(), c.modGlobals.end());
+        for (auto i : c.refParams)
+          AddAccess(s, f, UnderlyingObject(inst->ops[i]), false);
+        for (auto i : c.modParams)
+          AddAccess(s, f, UnderlyingObject(inst->ops[i]), true);
+      }
+  return s;
+}
+
+void ComputeModRef(Module &m)
+{
+  auto &summaries = Summaries();
+  summaries.clear();
+  for (auto &f : m.funcs)
+    summaries[f.get()] = f->isDecl() ? LibrarySummary(f->name) : ModRef();
+  // the summaries only grow, so the iteration ends, recursion included
+  for (bool changed = true; changed;)
+  {
+    changed = false;
+    for (auto it = m.funcs.rbegin(); it != m.funcs.rend(); ++it)
+    {
+      auto f = it->get();
+      if (f->isDecl())
+        continue;
+      auto s = Summarize(*f);
+      if (s == summaries[f])
+        continue;
+      summaries[f] = std::move(s);
+      changed = true;
+    }
+  }
+}
+
+const ModRef *GetModRef(Function *f)
+{
+  auto it = Summaries().find(f);
+  return it == Summaries().end() ? nullptr : &it->second;
+}
+
+bool CallMayAccess(Value *call, Value *ptr, bool mod)
+{
+  auto obj = UnderlyingObject(ptr);
+  if (obj && obj->kind == ValueKind::Alloc && !IsEscaping(obj))
+    return false;
+  auto s = GetModRef(call->callee);
+  if (!s || s->unknown)
+    return true;
+  auto &globals = mod ? s->modGlobals : s->refGlobals;
+  // a pointer passed in by the caller may point to any global or argument
+  bool any = !obj || obj->kind == ValueKind::FuncArg;
+  if (any ? !globals.empty() : globals.count(obj))
+    return true;
+  // an array reaches the callee only through the arguments, SysY cannot store pointers
+  for (auto i : mod ? s->modParams : s->refParams)
+  {
+    auto arg = UnderlyingObject(call->ops[i]);
+    if (any || !arg || arg == obj || (arg->kind == ValueKind::FuncArg && obj->kind == ValueKind::GlobalAlloc))
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,247 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+OptConfig &GetOptConfig()
+{
+  static OptConfig config;
+  return config;
+}
+
+void ParseOptArgs(int argc, const char *argv[])
+{
+  auto &config = GetOptConfig();
+  for (int i = 5; i < argc; ++i)
+  {
+    string arg = argv[i];
+    if (arg == "-O0")
+      config.enabled = false;
+    else if (arg == "-O1" || arg == "-O2")
+      config.enabled = true;
+    else if (arg.rfind("-unroll-factor=", 0) == 0)
+      config.unrollFactor = std::max(1, std::atoi(arg.c_str() + strlen("-unroll-factor=")));
+    else if (arg.rfind("-tile-size=", 0) == 0)
+      config.tileSize = std::max(0, std::atoi(arg.c_str() + strlen("-tile-size=")));
+    else if (arg == "-memoize")
+      config.memoize = true;
+    else
+      throw std::logic_error("unknown option " + arg);
+  }
+}
+
+bool RemoveUnreachableBlocks(Function &f)
+{
+  auto rpo = ReversePostOrder(f);
+  set<BasicBlock *> reachable(rpo.begin(), rpo.end());
+  vector<BasicBlock *> dead;
+  for (auto bb : f.blocks)
+    if (!reachable.count(bb))
+      dead.push_back(bb);
+  for (auto bb : dead)
+    for (auto s : bb->successors())
+      RemovePhiIncoming(s, bb);
+  for (auto bb : dead)
+    f.removeBlock(bb);
+  return !dead.empty();
+}
+
+bool DeadCodeElim(Function &f)
+{
+  set<Value *> live;
+  vector<Value *> work;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (inst->hasSideEffect())
+      {
+        live.insert(inst);
+        work.push_back(inst);
+      }
+  while (!work.empty())
+  {
+    auto inst = work.back();
+    work.pop_back();
+    for (auto op : inst->ops)
+      if (op->isInst() && live.insert(op).second)
+        work.push_back(op);
+  }
+  vector<Value *> dead;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (!live.count(inst))
+        dead.push_back(inst);
+  // drop operands first, dead instructions may use each other
+  for (auto inst : dead)
+    inst->dropOperands();
+  for (auto inst : dead)
+    inst->parent->remove(inst);
+  return !dead.empty();
+}
+
+/**
+ * @brief Bring the function back to the shape the RISC-V backend understands
+ * @details The backend keeps every value in a stack slot and only knows a few
+ * operand forms. Phis become stack slots, function arguments are only used by a
+ * store into an alloc, and blocks are printed in reverse post order so every
+ * definition appears before its uses.
+ */
+static void Finalize(Function &f)
+{
+  auto &m = *f.parent;
+  RemoveUnreachableBlocks(f);
+  DestructSSA(f);
+  f.buildCFG();
+  if (!f.entry()->preds.empty())
+  {
+    // the entry label is not emitted by the backend, so it can not be a jump target
+    auto body = f.entry();
+    body->name = m.uniqueLabel("%entry_body");
+    auto entry = f.newBlock("%entry");
+    entry->name = "%entry";
+    f.blocks.remove(entry);
+    f.blocks.push_front(entry);
+    entry->push_back(m.createJump(body));
+  }
+  auto entry = f.entry();
+  for (auto it = f.params.rbegin(); it != f.params.rend(); ++it)
+  {
+    auto arg = *it;
+    bool legal = true;
+    for (auto u : arg->users)
+      if (!(u->kind == ValueKind::Store && u->ops[0] == arg && u->ops[1]->kind == ValueKind::Alloc))
+        legal = false;
+    if (legal)
+      continue;
+    auto slot = m.createAlloc(arg->ty);
+    slot->name = arg->name;
+    auto store = m.createStore(arg, slot);
+    auto load = m.createLoad(slot);
+    for (auto u : vector<Value *>(arg->users))
+      if (u != store && !(u->kind == ValueKind::Store && u->ops[0] == arg && u->ops[1]->kind == ValueKind::Alloc))
+        for (size_t i = 0; i < u->ops.size(); ++i)
+          if (u->ops[i] == arg)
+            u->setOperand(i, load);
+    entry->insts.push_front(load);
+    entry->insts.push_front(store);
+    entry->insts.push_front(slot);
+    slot->parent = store->parent = load->parent = entry;
+  }
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      for (size_t i = 0; i < inst->ops.size(); ++i)
+        if (inst->ops[i]->kind == ValueKind::Undef && inst->ops[i]->ty->isInt())
+          inst->setOperand(i, m.getInt(0));
+  auto rpo = ReversePostOrder(f);
+  f.blocks.assign(rpo.begin(), rpo.end());
+}
+
+void Optimize(Module &m)
+{
+  // bring every function into SSA form first, so the inliner sees realistic sizes
+  ComputeModRef(m);
+  for (auto &f : m.funcs)
+  {
+    if (f->isDecl())
+      continue;
+    RemoveUnreachableBlocks(*f);
+    SROA(*f);
+    Mem2Reg(*f);
+    InstCombine(*f);
+    GVN(*f);
+    if (LoadElim(*f))
+      GVN(*f);
+    DeadStoreElim(*f);
+    SimplifyCFG(*f);
+    // recursion turned into loops no longer keeps the function from being inlined
+    if (TailRecursionElim(*f))
+      GVN(*f);
+    DeadCodeElim(*f);
+  }
+  // constant arguments shrink the callees before the inliner measures them
+  ConstantGlobals(m);
+  Specialize(m);
+  IPSCCP(m);
+  DeadArgElim(m);
+  // after IPSCCP, so parameters known to be constant are no longer part of the key
+  Memoize(m);
+  Inline(m);
+  // inlined callees may now load from constant globals at constant offsets
+  ConstantGlobals(m);
+  GlobalDCE(m);
+  // the interprocedural passes changed callees and their parameters
+  ComputeModRef(m);
+  // LoopIdiom declares the routines it calls, which adds to m.funcs
+  vector<Function *> funcs;
+  for (auto &f : m.funcs)
+    funcs.push_back(f.get());
+  for (auto f : funcs)
+  {
+    if (f->isDecl())
+      continue;
+    // arrays of inlined callees no longer escape into the call
+    if (SROA(*f))
+      Mem2Reg(*f);
+    InstCombine(*f);
+    GVN(*f);
+    if (LoadElim(*f))
+      GVN(*f);
+    SimplifyCFG(*f);
+    // fusing the inner loops of a nest can make it perfect for interchange
+    LoopFusion(*f);
+    // before LICM hoists the addresses of rows into the outer loop
+    LoopInterchange(*f);
+    LoopTiling(*f);
+    if (LICM(*f))
+      GVN(*f);
+    if (ScalarPromotion(*f))
+      GVN(*f);
+    // after LICM, so that invariant computations do not tie the parts together
+    LoopDistribution(*f);
+    // before unrolling, which would break the loops up, and ClosedFormLoops, which
+    // removes what is left of them
+    LoopIdiom(*f);
+    // after LICM, which hoists the computations of invariant conditions
+    if (LoopUnswitch(*f))
+    {
+      SimplifyCFG(*f);
+      GVN(*f);
+    }
+    if (ClosedFormLoops(*f))
+      GVN(*f);
+    if (Unroll(*f))
+    {
+      InstCombine(*f);
+      GVN(*f);
+      if (LoadElim(*f))
+        GVN(*f);
+    }
+    if (StrengthReduce(*f))
+      GVN(*f);
+    DeadStoreElim(*f);
+    DeadCodeElim(*f);
+    SimplifyCFG(*f);
+  }
+  // unrolling turns dynamic indices into constant ones
+  if (ConstantGlobals(m))
+    for (auto &f : m.funcs)
+    {
+      if (f->isDecl())
+        continue;
+      InstCombine(*f);
+      GVN(*f);
+      DeadCodeElim(*f);
+    }
+  GlobalDCE(m);
+  for (auto &f : m.funcs)
+    if (!f->isDecl())
+      Finalize(*f);
+}
+
+string OptimizeIR(const string &ir)
+{
+  auto m = ParseIR(ir);
+  Optimize(*m);
+  return DumpIR(*m);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "IR.hpp"
+
+struct OptConfig
+{
+  // -O0 turns the optimizer off, the frontend output is then used as is
+  bool enabled = true;
+  // -unroll-factor=n sets how many trips partial unrolling merges, 1 turns it off,
+  // other values than powers of two are rounded down to one
+  int unrollFactor = 4;
+  // -memoize caches the results of pure recursive functions in fixed size tables
+  bool memoize = false;
+  // -tile-size=n cuts loops into tiles of n trips, 0 leaves it to a cache model and
+  // 1 turns tiling off
+  int tileSize = 0;
+};
+OptConfig &GetOptConfig();
+// parse options which follow "compiler mode input -o output"
+void ParseOptArgs(int argc, const char *argv[]);
+
+// utilities
+bool RemoveUnreachableBlocks(Function &f);
+bool SimplifyCFG(Function &f);
+bool DeadCodeElim(Function &f);
+
+// SSA construction and destruction
+bool SROA(Function &f);
+bool Mem2Reg(Function &f);
+void DestructSSA(Function &f);
+
+// scalar passes
+bool InstCombine(Function &f);
+bool GVN(Function &f);
+bool LoadElim(Function &f);
+bool DeadStoreElim(Function &f);
+bool TailRecursionElim(Function &f);
+
+// loop passes
+bool LICM(Function &f);
+bool LoopFusion(Function &f);
+bool LoopDistribution(Function &f);
+bool LoopIdiom(Function &f);
+bool LoopInterchange(Function &f);
+bool LoopTiling(Function &f);
+bool ScalarPromotion(Function &f);
+bool LoopUnswitch(Function &f);
+bool StrengthReduce(Function &f);
+bool ClosedFormLoops(Function &f);
+bool Unroll(Function &f);
+
+// interprocedural passes
+bool Inline(Module &m);
+bool IPSCCP(Module &m);
+bool Specialize(Module &m);
+bool DeadArgElim(Module &m);
+bool GlobalDCE(Module &m);
+bool ConstantGlobals(Module &m);
+bool Memoize(Module &m);
+
+void Optimize(Module &m);
+string OptimizeIR(const string &ir);
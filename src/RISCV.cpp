@@ -1,5 +1,6 @@
 #include <string>
 #include <cassert>
+#include <cstdint>
 #include <typeinfo>
 #include <iostream>
 #include <fstream>
@@ -66,6 +67,8 @@ void Visit_func(const koopa_raw_function_t &func, std::ostream &outfile)
 
     if (func->bbs.len == 0)
     {
+        // 库函数由运行时提供, 只有 LoopIdiom 调用的例程由这里生成
+        Visit_routine(string(func->name).substr(1), outfile);
         return;
     }
     auto name = string(func->name).substr(1);
@@ -349,6 +352,7 @@ void Visit_load(const koopa_raw_value_t &value, std::ostream &outfile)
         outfile << "  lw\tt0, 0(t0)\n";
         break;
     case KOOPA_RVT_GET_PTR:
+    case KOOPA_RVT_LOAD:
 
         loadstack = kirinfo.find(outfile, load.src);
         outfile << "  lw\tt0, " + loadstack << endl;
@@ -367,6 +371,11 @@ void Visit_load(const koopa_raw_value_t &value, std::ostream &outfile)
 
 void Visit_store(const koopa_raw_store_t &store, std::ostream &outfile)
 {
+    if (store.value->kind.tag == KOOPA_RVT_ZERO_INIT)
+    {
+        store_zeroinit(store.dest, outfile);
+        return;
+    }
 
     string store_value_reg = "t" + to_string(kirinfo.register_num++);
 
@@ -393,6 +402,10 @@ void Visit_store(const koopa_raw_store_t &store, std::ostream &outfile)
         Visit_val(store.value, outfile);
         outfile << "\n";
     }
+    else if (store.value->kind.tag == KOOPA_RVT_ALLOC || store.value->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+    {
+        load_address(store.value, store_value_reg, outfile);
+    }
     else
     {
 
@@ -427,6 +440,7 @@ void Visit_store(const koopa_raw_store_t &store, std::ostream &outfile)
         outfile << "  sw\t" + store_value_reg + ", 0(" + dest_reg + ")" << endl;
         break;
     case KOOPA_RVT_GET_PTR:
+    case KOOPA_RVT_LOAD:
 
         ++kirinfo.register_num;
         dest_stack = kirinfo.find(outfile, store.dest);
@@ -442,6 +456,95 @@ void Visit_store(const koopa_raw_store_t &store, std::ostream &outfile)
     return;
 }
 
+void store_zeroinit(const koopa_raw_value_t &dest, std::ostream &outfile)
+{
+    int words = 1;
+    auto kind = dest->ty->data.pointer.base;
+    while (kind->tag == KOOPA_RTT_ARRAY)
+    {
+        words *= kind->data.array.len;
+        kind = kind->data.array.base;
+    }
+    string addr_reg = "t" + to_string(kirinfo.register_num++);
+    load_address(dest, addr_reg, outfile);
+    // 小数组直接展开, 大数组每轮清零 4 个字, 剩下不足 4 个的字再展开
+    int rest = words;
+    if (words > 8)
+    {
+        string end_reg = "t" + to_string(kirinfo.register_num++);
+        outfile << "  li\t" + end_reg + ", " + to_string(words / 4 * 16) << endl;
+        outfile << "  add\t" + end_reg + ", " + addr_reg + ", " + end_reg << endl;
+        outfile << "1:\n";
+        for (int i = 0; i < 4; ++i)
+        {
+            outfile << "  sw\tzero, " + to_string(i * 4) + "(" + addr_reg + ")" << endl;
+        }
+        outfile << "  addi\t" + addr_reg + ", " + addr_reg + ", 16" << endl;
+        outfile << "  bltu\t" + addr_reg + ", " + end_reg + ", 1b" << endl;
+        rest = words % 4;
+    }
+    for (int i = 0; i < rest; ++i)
+    {
+        outfile << "  sw\tzero, " + to_string(i * 4) + "(" + addr_reg + ")" << endl;
+    }
+}
+
+void Visit_routine(const string &name, std::ostream &outfile)
+{
+    // a0 为目标地址, a1 为填充值或源地址, a2 为字数, 每轮处理 4 个字
+    if (name == "__fill_words")
+    {
+        outfile << "\t.text\n__fill_words:\n"
+                   "  li\tt0, 4\n"
+                   "  blt\ta2, t0, 2f\n"
+                   "1:\n"
+                   "  sw\ta1, 0(a0)\n"
+                   "  sw\ta1, 4(a0)\n"
+                   "  sw\ta1, 8(a0)\n"
+                   "  sw\ta1, 12(a0)\n"
+                   "  addi\ta0, a0, 16\n"
+                   "  addi\ta2, a2, -4\n"
+                   "  bge\ta2, t0, 1b\n"
+                   "2:\n"
+                   "  blez\ta2, 3f\n"
+                   "  sw\ta1, 0(a0)\n"
+                   "  addi\ta0, a0, 4\n"
+                   "  addi\ta2, a2, -1\n"
+                   "  j\t2b\n"
+                   "3:\n"
+                   "  ret\n\n";
+    }
+    else if (name == "__copy_words")
+    {
+        outfile << "\t.text\n__copy_words:\n"
+                   "  li\tt0, 4\n"
+                   "  blt\ta2, t0, 2f\n"
+                   "1:\n"
+                   "  lw\tt1, 0(a1)\n"
+                   "  lw\tt2, 4(a1)\n"
+                   "  lw\tt3, 8(a1)\n"
+                   "  lw\tt4, 12(a1)\n"
+                   "  sw\tt1, 0(a0)\n"
+                   "  sw\tt2, 4(a0)\n"
+                   "  sw\tt3, 8(a0)\n"
+                   "  sw\tt4, 12(a0)\n"
+                   "  addi\ta0, a0, 16\n"
+                   "  addi\ta1, a1, 16\n"
+                   "  addi\ta2, a2, -4\n"
+                   "  bge\ta2, t0, 1b\n"
+                   "2:\n"
+                   "  blez\ta2, 3f\n"
+                   "  lw\tt1, 0(a1)\n"
+                   "  sw\tt1, 0(a0)\n"
+                   "  addi\ta0, a0, 4\n"
+                   "  addi\ta1, a1, 4\n"
+                   "  addi\ta2, a2, -1\n"
+                   "  j\t2b\n"
+                   "3:\n"
+                   "  ret\n\n";
+    }
+}
+
 void Visit_jump(const koopa_raw_jump_t &jump, std::ostream &outfile)
 {
     string jump_target = jump.target->name;
@@ -625,83 +728,102 @@ void visit_aggregate(const koopa_raw_value_t &aggregate, std::ostream &outfile)
     }
 }
 
-void visit_getelemptr(const koopa_raw_value_t &getelemptr, std::ostream &outfile)
+void load_address(const koopa_raw_value_t &ptr, const string &reg, std::ostream &outfile)
 {
-    auto src = getelemptr->kind.data.get_elem_ptr.src;
-    auto index = getelemptr->kind.data.get_elem_ptr.index;
-
-    auto kind = getelemptr->ty->data.pointer.base;
-    int arraysize = 1;
-    while (kind->tag == KOOPA_RTT_ARRAY)
+    if (ptr->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
     {
-
-        int cursize = kind->data.array.len;
-        arraysize *= cursize;
-        kind = kind->data.array.base;
-    }
-
-    string src_reg = "t" + to_string(kirinfo.register_num++);
-
-    if (src->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
-    {
-
-        string global_name = src->name;
+        string global_name = ptr->name;
 
         global_name = global_name.substr(1);
-        outfile << "  la\t" + src_reg + ", " + global_name << endl;
+        outfile << "  la\t" + reg + ", " + global_name << endl;
     }
-    else if (src->kind.tag == KOOPA_RVT_ALLOC)
+    else if (ptr->kind.tag == KOOPA_RVT_ALLOC)
     {
-        int srcstack = kirinfo.find_value_in_stack_int(src);
+        int srcstack = kirinfo.find_value_in_stack_int(ptr);
         if (srcstack < 2047)
         {
-            outfile << "  addi\t" + src_reg + ", sp, " + to_string(srcstack) << endl;
+            outfile << "  addi\t" + reg + ", sp, " + to_string(srcstack) << endl;
         }
         else
         {
-            outfile << "  li\t" + src_reg + ", " + to_string(srcstack) << endl;
-            outfile << "  add\t" + src_reg + ", sp, " + src_reg << endl;
+            outfile << "  li\t" + reg + ", " + to_string(srcstack) << endl;
+            outfile << "  add\t" + reg + ", sp, " + reg << endl;
         }
     }
-    else if (src->kind.tag == KOOPA_RVT_GET_ELEM_PTR)
-    {
-        string srcstack = kirinfo.find(outfile, src);
-        outfile << "  lw\t" + src_reg + ", " + srcstack << endl;
-    }
-    else if (src->kind.tag == KOOPA_RVT_GET_PTR)
-    {
-        string srcstack = kirinfo.find(outfile, src);
-        outfile << "  lw\t" + src_reg + ", " + srcstack << endl;
-    }
     else
     {
+        // 其余指针 (getelemptr, getptr, load) 的值保存在栈上
+        string srcstack = kirinfo.find(outfile, ptr);
+        outfile << "  lw\t" + reg + ", " + srcstack << endl;
     }
+}
 
-    string indexreg = "t" + to_string(kirinfo.register_num++);
+void add_scaled_index(const koopa_raw_value_t &index, int size, const string &reg, std::ostream &outfile)
+{
     if (index->kind.tag == KOOPA_RVT_INTEGER)
     {
-        if (index->kind.data.integer.value == 0 && arraysize == 1)
+        // 常量下标直接折叠成偏移
+        int offset = int(int64_t(index->kind.data.integer.value) * size);
+        if (offset == 0)
         {
-            string geteleptr_stack = kirinfo.find(outfile, getelemptr);
-            outfile << "  sw\t" + src_reg + ", " + geteleptr_stack + "\n";
             return;
         }
+        if (offset >= -2048 && offset < 2048)
+        {
+            outfile << "  addi\t" + reg + ", " + reg + ", " + to_string(offset) << endl;
+        }
+        else
+        {
+            string offset_reg = "t" + to_string(kirinfo.register_num++);
+            outfile << "  li\t" + offset_reg + ", " + to_string(offset) << endl;
+            outfile << "  add\t" + reg + ", " + reg + ", " + offset_reg << endl;
+        }
+        return;
+    }
 
-        outfile << "  li\t" + indexreg + ", ";
-        Visit_int(index->kind.data.integer, outfile);
+    string indexreg = "t" + to_string(kirinfo.register_num++);
+    string index_stack = kirinfo.find(outfile, index);
+    outfile << "  lw\t" + indexreg + ", " + index_stack << endl;
+    if ((size & (size - 1)) == 0)
+    {
+        // 元素大小是 2 的幂时用移位代替乘法
+        int shift = 0;
+        while ((1 << shift) < size)
+        {
+            ++shift;
+        }
+        if (shift != 0)
+        {
+            outfile << "  slli\t" + indexreg + ", " + indexreg + ", " + to_string(shift) << endl;
+        }
     }
     else
     {
-        string index_stack = kirinfo.find(outfile, index);
-        outfile << "  lw\t" + indexreg + ", " + index_stack;
+        string size_reg = "t" + to_string(kirinfo.register_num++);
+        outfile << "  li\t" + size_reg + ", " + to_string(size) << endl;
+        outfile << "  mul\t" + indexreg + ", " + indexreg + ", " + size_reg << endl;
     }
+    outfile << "  add\t" + reg + ", " + reg + ", " + indexreg << endl;
+}
 
-    string size_reg = "t" + to_string(kirinfo.register_num++);
-    arraysize *= 4;
-    outfile << "\n  li\t" + size_reg + ", " + to_string(arraysize) + "\n";
-    outfile << "  mul\t" + indexreg + ", " + indexreg + ", " + size_reg + "\n";
+void visit_getelemptr(const koopa_raw_value_t &getelemptr, std::ostream &outfile)
+{
+    auto src = getelemptr->kind.data.get_elem_ptr.src;
+    auto index = getelemptr->kind.data.get_elem_ptr.index;
 
-    outfile << "  add\t" + src_reg + ", " + src_reg + ", " + indexreg + "\n";
+    auto kind = getelemptr->ty->data.pointer.base;
+    int arraysize = 1;
+    while (kind->tag == KOOPA_RTT_ARRAY)
+    {
+
+        int cursize = kind->data.array.len;
+        arraysize *= cursize;
+        kind = kind->data.array.base;
+    }
+
+    string src_reg = "t" + to_string(kirinfo.register_num++);
+    load_address(src, src_reg, outfile);
+    add_scaled_index(index, arraysize * 4, src_reg, outfile);
 
     string geteleptr_stack = kirinfo.find(outfile, getelemptr);
     outfile << "  sw\t" + src_reg + ", " + geteleptr_stack + "\n";
@@ -725,41 +847,8 @@ void visit_getptr(const koopa_raw_value_t &getptr, std::ostream &outfile)
     }
 
     string src_reg = "t" + to_string(kirinfo.register_num++);
-
-    if (src->kind.tag == KOOPA_RVT_LOAD)
-    {
-        string srcstack = kirinfo.find(outfile, src);
-        outfile << "  lw\t" + src_reg + ", " + srcstack << endl;
-    }
-    else
-    {
-    }
-
-    string indexreg = "t" + to_string(kirinfo.register_num++);
-    if (index->kind.tag == KOOPA_RVT_INTEGER)
-    {
-        if (index->kind.data.integer.value == 0 && arraysize == 1)
-        {
-            string getptr_stack = kirinfo.find(outfile, getptr);
-            outfile << "  sw\t" + src_reg + ", " + getptr_stack + "\n";
-            return;
-        }
-
-        outfile << "  li\t" + indexreg + ", ";
-        Visit_int(index->kind.data.integer, outfile);
-    }
-    else
-    {
-        string index_stack = kirinfo.find(outfile, index);
-        outfile << "  lw\t" + indexreg + ", " + index_stack;
-    }
-
-    string size_reg = "t" + to_string(kirinfo.register_num++);
-    arraysize *= 4;
-    outfile << "\n  li\t" + size_reg + ", " + to_string(arraysize) + "\n";
-    outfile << "  mul\t" + indexreg + ", " + indexreg + ", " + size_reg + "\n";
-
-    outfile << "  add\t" + src_reg + ", " + src_reg + ", " + indexreg + "\n";
+    load_address(src, src_reg, outfile);
+    add_scaled_index(index, arraysize * 4, src_reg, outfile);
 
     string getptr_stack = kirinfo.find(outfile, getptr);
     outfile << "  sw\t" + src_reg + ", " + getptr_stack + "\n";
@@ -781,8 +870,8 @@ void Visit_binary(const koopa_raw_value_t &value, ostream &outfile)
         Visit_bin_cond(value, outfile);
         break;
     case KOOPA_RBO_OR:
-        outfile << "\t #ne \n";
-        Visit_bin_cond(value, outfile);
+        outfile << "\t #or \n";
+        Visit_bin_double_reg(value, outfile);
         break;
     case KOOPA_RBO_GT:
         outfile << "\t #gt \n";
@@ -802,7 +891,23 @@ void Visit_binary(const koopa_raw_value_t &value, ostream &outfile)
         break;
     case KOOPA_RBO_AND:
         outfile << "\t #and \n";
-        Visit_bin_cond(value, outfile);
+        Visit_bin_double_reg(value, outfile);
+        break;
+    case KOOPA_RBO_XOR:
+        outfile << "\t #xor \n";
+        Visit_bin_double_reg(value, outfile);
+        break;
+    case KOOPA_RBO_SHL:
+        outfile << "\t #shl \n";
+        Visit_bin_double_reg(value, outfile);
+        break;
+    case KOOPA_RBO_SHR:
+        outfile << "\t #shr \n";
+        Visit_bin_double_reg(value, outfile);
+        break;
+    case KOOPA_RBO_SAR:
+        outfile << "\t #sar \n";
+        Visit_bin_double_reg(value, outfile);
         break;
     case KOOPA_RBO_ADD:
         outfile << "\t # add\n";
@@ -854,11 +959,6 @@ void Visit_bin_cond(const koopa_raw_value_t &value, ostream &outfile)
         outfile << "  xor\t" + eqregister + ", " + leftreg + ", " + rightreg + '\n';
         outfile << "  snez\t" + eqregister + ", " + eqregister + '\n';
         break;
-    case KOOPA_RBO_OR:
-
-        outfile << "  or\t" + eqregister + ", " + leftreg + ", " + rightreg + '\n';
-        outfile << "  snez\t" + eqregister + ", " + eqregister + '\n';
-        break;
     case KOOPA_RBO_GT:
 
         outfile << "  slt\t" + eqregister + ", " + rightreg + ", " + leftreg + '\n';
@@ -877,12 +977,6 @@ void Visit_bin_cond(const koopa_raw_value_t &value, ostream &outfile)
         outfile << "  slt\t" + eqregister + ", " + rightreg + ", " + leftreg + '\n';
         outfile << "  xori\t" + eqregister + ", " + eqregister + ", 1\n";
         break;
-    case KOOPA_RBO_AND:
-
-        outfile << "  snez\t" + leftreg + ", " + leftreg + '\n';
-        outfile << "  snez\t" + rightreg + ", " + rightreg + '\n';
-        outfile << "  and\t" + eqregister + ", " + leftreg + ", " + rightreg + '\n';
-        break;
     default:
         assert(false);
     }
@@ -897,6 +991,10 @@ void Visit_bin_double_reg(const koopa_raw_value_t &value, ostream &outfile)
 {
 
     const auto &binary = value->kind.data.binary;
+    if (Visit_bin_const(value, outfile))
+    {
+        return;
+    }
     string bin_op;
     switch (binary.op)
     {
@@ -915,6 +1013,24 @@ void Visit_bin_double_reg(const koopa_raw_value_t &value, ostream &outfile)
     case KOOPA_RBO_MOD:
         bin_op = "rem";
         break;
+    case KOOPA_RBO_AND:
+        bin_op = "and";
+        break;
+    case KOOPA_RBO_OR:
+        bin_op = "or";
+        break;
+    case KOOPA_RBO_XOR:
+        bin_op = "xor";
+        break;
+    case KOOPA_RBO_SHL:
+        bin_op = "sll";
+        break;
+    case KOOPA_RBO_SHR:
+        bin_op = "srl";
+        break;
+    case KOOPA_RBO_SAR:
+        bin_op = "sra";
+        break;
     default:
         assert(false);
     }
@@ -930,6 +1046,234 @@ void Visit_bin_double_reg(const koopa_raw_value_t &value, ostream &outfile)
     outfile << "  sw\t" + eqregister + ", " + instr_stack << endl;
 }
 
+bool Visit_bin_const(const koopa_raw_value_t &value, ostream &outfile)
+{
+    const auto &binary = value->kind.data.binary;
+    if (binary.op != KOOPA_RBO_MUL && binary.op != KOOPA_RBO_DIV && binary.op != KOOPA_RBO_MOD)
+    {
+        return false;
+    }
+    koopa_raw_value_t var = binary.lhs, constant = binary.rhs;
+    if (binary.op == KOOPA_RBO_MUL && var->kind.tag == KOOPA_RVT_INTEGER)
+    {
+        swap(var, constant);
+    }
+    if (var->kind.tag == KOOPA_RVT_INTEGER || constant->kind.tag != KOOPA_RVT_INTEGER ||
+        constant->kind.data.integer.value == 0)
+    {
+        return false;
+    }
+    int c = constant->kind.data.integer.value;
+
+    kirinfo.regMap[value] = kirinfo.register_num++;
+    string eqregister = get_reg_(value);
+    string srcreg = "t" + to_string(kirinfo.register_num++);
+    string var_stack = kirinfo.find(outfile, var);
+    outfile << "  lw\t" + srcreg + ", " + var_stack << endl;
+    switch (binary.op)
+    {
+    case KOOPA_RBO_MUL:
+        mul_const(eqregister, srcreg, c, outfile);
+        break;
+    case KOOPA_RBO_DIV:
+        div_const(eqregister, srcreg, c, outfile);
+        break;
+    default:
+        rem_const(eqregister, srcreg, c, outfile);
+        break;
+    }
+    string instr_stack = kirinfo.find(outfile, value);
+    outfile << "  sw\t" + eqregister + ", " + instr_stack << endl;
+    return true;
+}
+
+// 2 的幂的指数, 不是 2 的幂时返回 -1
+static int log2_exact(uint32_t u)
+{
+    if (u == 0 || (u & (u - 1)) != 0)
+    {
+        return -1;
+    }
+    int k = 0;
+    while ((uint32_t(1) << k) != u)
+    {
+        ++k;
+    }
+    return k;
+}
+
+void mul_const(const string &dst, const string &src, int c, std::ostream &outfile)
+{
+    // 乘以 2^a, 2^a + 1, 2^a - 1, 2^a + 2^b 及其相反数时用移位和加减代替乘法
+    uint32_t u = c < 0 ? -uint32_t(c) : uint32_t(c);
+    int k;
+    if ((k = log2_exact(u)) >= 0)
+    {
+        outfile << "  slli\t" + dst + ", " + src + ", " + to_string(k) << endl;
+    }
+    else if ((k = log2_exact(u - 1)) >= 0)
+    {
+        outfile << "  slli\t" + dst + ", " + src + ", " + to_string(k) << endl;
+        outfile << "  add\t" + dst + ", " + dst + ", " + src << endl;
+    }
+    else if ((k = log2_exact(u + 1)) >= 0)
+    {
+        outfile << "  slli\t" + dst + ", " + src + ", " + to_string(k) << endl;
+        outfile << "  sub\t" + dst + ", " + dst + ", " + src << endl;
+    }
+    else if ((k = log2_exact(u & (u - 1))) >= 0)
+    {
+        // 恰有两位为 1 的常数
+        string shiftreg = "t" + to_string(kirinfo.register_num++);
+        outfile << "  slli\t" + shiftreg + ", " + src + ", " + to_string(k) << endl;
+        outfile << "  slli\t" + dst + ", " + src + ", " + to_string(log2_exact(u & -u)) << endl;
+        outfile << "  add\t" + dst + ", " + dst + ", " + shiftreg << endl;
+    }
+    else
+    {
+        string constreg = "t" + to_string(kirinfo.register_num++);
+        outfile << "  li\t" + constreg + ", " + to_string(c) << endl;
+        outfile << "  mul\t" + dst + ", " + src + ", " + constreg << endl;
+        return;
+    }
+    if (c < 0)
+    {
+        outfile << "  neg\t" + dst + ", " + dst << endl;
+    }
+}
+
+// src + (src < 0 ? 2^k - 1 : 0), 向零取整的除法先加上这个偏置再右移
+static void add_div_bias(const string &dst, const string &src, int k, std::ostream &outfile)
+{
+    if (k == 1)
+    {
+        outfile << "  srli\t" + dst + ", " + src + ", 31" << endl;
+    }
+    else
+    {
+        outfile << "  srai\t" + dst + ", " + src + ", 31" << endl;
+        outfile << "  srli\t" + dst + ", " + dst + ", " + to_string(32 - k) << endl;
+    }
+    outfile << "  add\t" + dst + ", " + src + ", " + dst << endl;
+}
+
+// 有符号除法的魔数, 见 Hacker's Delight 10-4 节
+static void signed_magic(int d, int32_t &magic, int &shift)
+{
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? -uint32_t(d) : uint32_t(d);
+    uint32_t t = two31 + (uint32_t(d) >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do
+    {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad)
+        {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    magic = int32_t(q2 + 1);
+    if (d < 0)
+    {
+        magic = -magic;
+    }
+    shift = p - 32;
+}
+
+void div_const(const string &dst, const string &src, int c, std::ostream &outfile)
+{
+    uint32_t u = c < 0 ? -uint32_t(c) : uint32_t(c);
+    int k = log2_exact(u);
+    if (k == 0)
+    {
+        outfile << "  mv\t" + dst + ", " + src << endl;
+    }
+    else if (k > 0)
+    {
+        add_div_bias(dst, src, k, outfile);
+        outfile << "  srai\t" + dst + ", " + dst + ", " + to_string(k) << endl;
+    }
+    else
+    {
+        // q = mulh(src, magic), 修正后右移, 负数的商再加 1 向零取整
+        int32_t magic;
+        int shift;
+        signed_magic(c, magic, shift);
+        string magicreg = "t" + to_string(kirinfo.register_num++);
+        outfile << "  li\t" + magicreg + ", " + to_string(magic) << endl;
+        outfile << "  mulh\t" + dst + ", " + src + ", " + magicreg << endl;
+        if (c > 0 && magic < 0)
+        {
+            outfile << "  add\t" + dst + ", " + dst + ", " + src << endl;
+        }
+        else if (c < 0 && magic > 0)
+        {
+            outfile << "  sub\t" + dst + ", " + dst + ", " + src << endl;
+        }
+        if (shift != 0)
+        {
+            outfile << "  srai\t" + dst + ", " + dst + ", " + to_string(shift) << endl;
+        }
+        outfile << "  srli\t" + magicreg + ", " + dst + ", 31" << endl;
+        outfile << "  add\t" + dst + ", " + dst + ", " + magicreg << endl;
+        return;
+    }
+    if (c < 0)
+    {
+        outfile << "  neg\t" + dst + ", " + dst << endl;
+    }
+}
+
+void rem_const(const string &dst, const string &src, int c, std::ostream &outfile)
+{
+    // 余数的符号与被除数相同, 与除数的符号无关
+    uint32_t u = c < 0 ? -uint32_t(c) : uint32_t(c);
+    int k = log2_exact(u);
+    if (k == 0)
+    {
+        outfile << "  mv\t" + dst + ", x0" << endl;
+        return;
+    }
+    string tmpreg = "t" + to_string(kirinfo.register_num++);
+    if (k > 0)
+    {
+        // src - (src + 偏置) & -2^k
+        add_div_bias(tmpreg, src, k, outfile);
+        int mask = int(-(uint32_t(1) << k));
+        if (mask >= -2048)
+        {
+            outfile << "  andi\t" + tmpreg + ", " + tmpreg + ", " + to_string(mask) << endl;
+        }
+        else
+        {
+            outfile << "  li\t" + dst + ", " + to_string(mask) << endl;
+            outfile << "  and\t" + tmpreg + ", " + tmpreg + ", " + dst << endl;
+        }
+    }
+    else
+    {
+        // src - (src / c) * c
+        div_const(dst, src, c, outfile);
+        mul_const(tmpreg, dst, c, outfile);
+    }
+    outfile << "  sub\t" + dst + ", " + src + ", " + tmpreg << endl;
+}
+
 void handle_left_right_reg(const koopa_raw_value_t &value, ostream &outfile, string &leftreg, string &rightreg, string &eqregister)
 {
     const auto &binary = value->kind.data.binary;
@@ -25,6 +25,10 @@ void Visit_int(const koopa_raw_integer_t &integer, std::ostream &outfile);
 void Visit_alloc(const koopa_raw_value_t &value, std::ostream &outfile);
 void Visit_load(const koopa_raw_value_t &value, std::ostream &outfile);
 void Visit_store(const koopa_raw_store_t &store, std::ostream &outfile);
+// 整个数组清零, 大数组用每轮 4 个字的循环
+void store_zeroinit(const koopa_raw_value_t &dest, std::ostream &outfile);
+// LoopIdiom 调用的 __fill_words 和 __copy_words
+void Visit_routine(const std::string &name, std::ostream &outfile);
 void Visit_jump(const koopa_raw_jump_t &jump, std::ostream &outfile);
 void Visit_branch(const koopa_raw_branch_t &branch, std::ostream &outfile);
 void Visit_call(const koopa_raw_value_t &value, std::ostream &outfile);
@@ -32,11 +36,18 @@ void Visit_global_alloc(const koopa_raw_value_t &value, std::ostream &outfile);
 void visit_aggregate(const koopa_raw_value_t &aggregate, std::ostream &outfile);
 void visit_getelemptr(const koopa_raw_value_t &getelemptr, std::ostream &outfile);
 void visit_getptr(const koopa_raw_value_t &getptr, std::ostream &outfile);
+void load_address(const koopa_raw_value_t &ptr, const std::string &reg, std::ostream &outfile);
+void add_scaled_index(const koopa_raw_value_t &index, int size, const std::string &reg, std::ostream &outfile);
 
 //二元运算
 void Visit_binary(const koopa_raw_value_t &value, std::ostream &outfile);
 void Visit_bin_cond(const koopa_raw_value_t &value, std::ostream &outfile);
 void Visit_bin_double_reg(const koopa_raw_value_t &value, std::ostream &outfile);
+// 乘除模常数时用移位, 加减和魔数乘法代替 mul, div 和 rem
+bool Visit_bin_const(const koopa_raw_value_t &value, std::ostream &outfile);
+void mul_const(const std::string &dst, const std::string &src, int c, std::ostream &outfile);
+void div_const(const std::string &dst, const std::string &src, int c, std::ostream &outfile);
+void rem_const(const std::string &dst, const std::string &src, int c, std::ostream &outfile);
 
 // 特殊方法
 void handle_left_right_reg(const koopa_raw_value_t &value, std::ostream &outfile, std::string &leftreg, std::string &rightreg,
@@ -0,0 +1,98 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+
+// only arrays of at most this many elements are split
+static const int kMaxElements = 16;
+
+/**
+ * @brief The accesses to a local array and the addresses leading to them
+ * @details addrs holds the alloc and the pointers derived from it, parents before
+ * their users. Every access is a load or store of a whole element or a store of
+ * zeroinit, at a constant offset inside the array.
+ */
+struct ArrayUses
+{
+  vector<Value *> addrs, accesses;
+};
+
+static std::optional<ArrayUses> CollectUses(Value *alloc)
+{
+  ArrayUses res;
+  res.addrs.push_back(alloc);
+  for (size_t i = 0; i < res.addrs.size(); ++i)
+    for (auto u : res.addrs[i]->users)
+    {
+      if ((u->kind == ValueKind::GetElemPtr || u->kind == ValueKind::GetPtr) && u->ops[0] == res.addrs[i])
+      {
+        res.addrs.push_back(u);
+        continue;
+      }
+      bool load = u->kind == ValueKind::Load && u->ty->isInt();
+      bool store = u->kind == ValueKind::Store && u->ops[1] == res.addrs[i] &&
+                   (u->ops[0]->ty->isInt() || u->ops[0]->kind == ValueKind::ZeroInit);
+      if (!load && !store)
+        return std::nullopt;
+      // a dynamic index or an out of range one keeps the array in memory
+      auto offset = PointerDistance(res.addrs[i], alloc);
+      int size = load ? u->ty->size() : u->ops[0]->ty->size();
+      if (!offset || *offset < 0 || *offset + size > alloc->ty->base->size())
+        return std::nullopt;
+      res.accesses.push_back(u);
+    }
+  return res;
+}
+
+/**
+ * @brief Scalar replacement of small local arrays
+ * @details A local array which is only accessed at constant indices is replaced by
+ * one scalar alloc per element, which Mem2Reg then promotes. A store of zeroinit
+ * becomes stores of 0 to the elements it covers. Arrays whose address escapes or
+ * which are accessed at a dynamic index stay in memory.
+ */
+bool SROA(Function &f)
+{
+  auto &m = *f.parent;
+  vector<Value *> allocs;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (inst->kind == ValueKind::Alloc && inst->ty->base->isArray() &&
+          inst->ty->base->size() <= kMaxElements * 4)
+        allocs.push_back(inst);
+
+  bool changed = false;
+  for (auto alloc : allocs)
+  {
+    auto uses = CollectUses(alloc);
+    if (!uses)
+      continue;
+    vector<Value *> elems(alloc->ty->base->size() / 4, nullptr);
+    auto elem = [&](int i)
+    {
+      if (!elems[i])
+      {
+        elems[i] = m.createAlloc(Type::getInt32());
+        alloc->parent->insertAfter(alloc, elems[i]);
+      }
+      return elems[i];
+    };
+    for (auto inst : uses->accesses)
+    {
+      auto ptr = inst->kind == ValueKind::Load ? inst->ops[0] : inst->ops[1];
+      int first = *PointerDistance(ptr, alloc) / 4;
+      if (inst->kind == ValueKind::Load)
+        inst->setOperand(0, elem(first));
+      else if (inst->ops[0]->kind != ValueKind::ZeroInit)
+        inst->setOperand(1, elem(first));
+      else
+      {
+        for (int i = first; i < first + inst->ops[0]->ty->size() / 4; ++i)
+          inst->parent->insertBefore(inst, m.createStore(m.getInt(0), elem(i)));
+        inst->parent->erase(inst);
+      }
+    }
+    for (auto it = uses->addrs.rbegin(); it != uses->addrs.rend(); ++it)
+      (*it)->parent->erase(*it);
+    changed = true;
+  }
+  return changed;
+}
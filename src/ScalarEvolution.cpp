@@ -0,0 +1,419 @@
+#include "Analysis.hpp"
+#include <algorithm>
+#include <climits>
+
+static int WrapAdd(int a, int b) { return int(unsigned(a) + unsigned(b)); }
+static int WrapMul(int a, int b) { return int(unsigned(a) * unsigned(b)); }
+
+LinearExpr &LinearExpr::operator+=(const LinearExpr &o)
+{
+  constant = WrapAdd(constant, o.constant);
+  for (auto [v, c] : o.terms)
+  {
+    auto it = std::find_if(terms.begin(), terms.end(), [&](auto &t)
+                           { return t.first == v; });
+    if (it == terms.end())
+      terms.emplace_back(v, c);
+    else if ((it->second = WrapAdd(it->second, c)) == 0)
+      terms.erase(it);
+  }
+  return *this;
+}
+
+LinearExpr LinearExpr::operator*(int c) const
+{
+  LinearExpr res;
+  if (c == 0)
+    return res;
+  res.constant = WrapMul(constant, c);
+  for (auto [v, k] : terms)
+    if (WrapMul(k, c) != 0)
+      res.terms.emplace_back(v, WrapMul(k, c));
+  return res;
+}
+
+static bool IsZero(const LinearExpr &e) { return e.isConstant() && e.constant == 0; }
+
+static AddRec Sum(const AddRec &a, const AddRec &b)
+{
+  AddRec res = a.ops.size() >= b.ops.size() ? a : b;
+  auto &o = a.ops.size() >= b.ops.size() ? b : a;
+  for (size_t i = 0; i < o.ops.size(); ++i)
+    res.ops[i] += o.ops[i];
+  while (res.ops.size() > 1 && IsZero(res.ops.back()))
+    res.ops.pop_back();
+  return res;
+}
+
+static AddRec Scale(const AddRec &a, int c)
+{
+  AddRec res;
+  for (auto &e : a.ops)
+    res.ops.push_back(e * c);
+  while (res.ops.size() > 1 && IsZero(res.ops.back()))
+    res.ops.pop_back();
+  return res;
+}
+
+// the constant c if r is the invariant c
+static std::optional<int> ConstantOf(const AddRec *r)
+{
+  if (r->ops.size() == 1 && r->ops[0].isConstant())
+    return r->ops[0].constant;
+  return std::nullopt;
+}
+
+// the product of an invariant with a recurrence of constants
+static std::optional<AddRec> Product(const AddRec *inv, const AddRec *r)
+{
+  if (inv->ops.size() != 1 || !std::all_of(r->ops.begin(), r->ops.end(), [](auto &e)
+                                           { return e.isConstant(); }))
+    return std::nullopt;
+  AddRec res;
+  for (auto &e : r->ops)
+    res.ops.push_back(inv->ops[0] * e.constant);
+  while (res.ops.size() > 1 && IsZero(res.ops.back()))
+    res.ops.pop_back();
+  return res;
+}
+
+// the product of two recurrences of constants, from the differences of its values
+static std::optional<AddRec> ConstantProduct(const AddRec *a, const AddRec *b)
+{
+  auto constant = [](const AddRec *r)
+  {
+    return std::all_of(r->ops.begin(), r->ops.end(), [](auto &e)
+                       { return e.isConstant(); });
+  };
+  int degree = a->ops.size() + b->ops.size() - 2;
+  if (!constant(a) || !constant(b) || degree > 3)
+    return std::nullopt;
+  auto at = [](const AddRec *r, unsigned k)
+  {
+    // sum of ops[i] * C(k, i)
+    unsigned res = 0, binom = 1;
+    for (size_t i = 0; i < r->ops.size(); ++i)
+    {
+      res += unsigned(r->ops[i].constant) * binom;
+      binom = binom * (k - i) / (i + 1);
+    }
+    return res;
+  };
+  vector<unsigned> values;
+  for (int k = 0; k <= degree; ++k)
+    values.push_back(at(a, k) * at(b, k));
+  AddRec res;
+  for (int i = 0; i <= degree; ++i)
+  {
+    res.ops.emplace_back();
+    res.ops.back().constant = int(values[0]);
+    for (int k = 0; k + 1 < int(values.size()); ++k)
+      values[k] = values[k + 1] - values[k];
+    values.pop_back();
+  }
+  while (res.ops.size() > 1 && IsZero(res.ops.back()))
+    res.ops.pop_back();
+  return res;
+}
+
+const AddRec *ScalarEvolution::get(Value *v, Loop *loop)
+{
+  auto key = std::make_pair(loop, v);
+  if (auto it = _cache.find(key); it != _cache.end())
+    return it->second.get();
+  if (_visiting.count(v))
+    return nullptr;
+  auto res = compute(v, loop);
+  // a failure may be caused by a phi under construction, try again later
+  if (!res && !_visiting.empty())
+    return nullptr;
+  auto &slot = _cache[key];
+  slot = std::move(res);
+  return slot.get();
+}
+
+unique_ptr<AddRec> ScalarEvolution::compute(Value *v, Loop *loop)
+{
+  if (!v->ty->isInt() || v->kind == ValueKind::Undef)
+    return nullptr;
+  auto res = std::make_unique<AddRec>();
+  if (!loop->contains(v))
+  {
+    LinearExpr e;
+    if (v->kind == ValueKind::Integer)
+      e.constant = v->imm;
+    else
+      e.terms.emplace_back(v, 1);
+    res->ops.push_back(e);
+    return res;
+  }
+
+  if (v->kind == ValueKind::Binary)
+  {
+    auto l = get(v->ops[0], loop), r = get(v->ops[1], loop);
+    if (!l || !r)
+      return nullptr;
+    switch (v->op)
+    {
+    case BinaryOp::Add:
+      *res = Sum(*l, *r);
+      break;
+    case BinaryOp::Sub:
+      *res = Sum(*l, Scale(*r, -1));
+      break;
+    case BinaryOp::Mul:
+      if (auto c = ConstantOf(r))
+        *res = Scale(*l, *c);
+      else if (auto c = ConstantOf(l))
+        *res = Scale(*r, *c);
+      else if (auto p = Product(l, r))
+        *res = *p;
+      else if (auto p = Product(r, l))
+        *res = *p;
+      else if (auto p = ConstantProduct(l, r))
+        *res = *p;
+      else
+        return nullptr;
+      break;
+    case BinaryOp::Shl:
+    {
+      auto c = ConstantOf(r);
+      if (!c || *c < 0 || *c > 31)
+        return nullptr;
+      *res = Scale(*l, int(1u << *c));
+      break;
+    }
+    default:
+      return nullptr;
+    }
+  }
+  else if (v->kind == ValueKind::Phi && v->parent == loop->header && v->ops.size() == 2)
+  {
+    auto ph = loop->preheader();
+    if (!ph || (v->blocks[0] != ph && v->blocks[1] != ph))
+      return nullptr;
+    auto init = v->blocks[0] == ph ? v->ops[0] : v->ops[1];
+    auto next = v->blocks[0] == ph ? v->ops[1] : v->ops[0];
+    auto start = get(init, loop);
+    if (!start || start->ops.size() != 1)
+      return nullptr;
+    // phi = {start, +, rest} where next = phi + rest
+    AddRec rest;
+    _visiting.insert(v);
+    bool ok = splitSelf(next, v, loop, rest);
+    _visiting.erase(v);
+    if (!ok)
+      return nullptr;
+    res->ops.push_back(start->ops[0]);
+    res->ops.insert(res->ops.end(), rest.ops.begin(), rest.ops.end());
+    while (res->ops.size() > 1 && IsZero(res->ops.back()))
+      res->ops.pop_back();
+  }
+  else
+    return nullptr;
+  return res->ops.size() <= 4 ? std::move(res) : nullptr;
+}
+
+bool ScalarEvolution::splitSelf(Value *v, Value *phi, Loop *loop, AddRec &rest)
+{
+  if (v == phi)
+  {
+    rest.ops = {LinearExpr()};
+    return true;
+  }
+  if (v->kind != ValueKind::Binary || !loop->contains(v) || (v->op != BinaryOp::Add && v->op != BinaryOp::Sub))
+    return false;
+  AddRec inner;
+  for (int i = 0; i < 2; ++i)
+  {
+    if (i == 1 && v->op == BinaryOp::Sub)
+      break;
+    if (!splitSelf(v->ops[i], phi, loop, inner))
+      continue;
+    auto other = get(v->ops[1 - i], loop);
+    if (!other)
+      return false;
+    rest = Sum(inner, v->op == BinaryOp::Sub ? Scale(*other, -1) : *other);
+    return true;
+  }
+  return false;
+}
+
+// the loop runs while {start, +, step} op bound holds
+bool ScalarEvolution::exitTest(Loop *loop, LinearExpr &start, int &step, BinaryOp &op, LinearExpr &bound)
+{
+  auto h = loop->header;
+  auto exiting = loop->exitingBlocks();
+  if (exiting.size() != 1 || exiting[0] != h || !loop->preheader() || h->preds.size() != 2)
+    return false;
+  auto br = h->terminator();
+  if (br->kind != ValueKind::Branch)
+    return false;
+  // a branch on a value which is not a comparison tests it against 0
+  auto cmp = br->ops[0];
+  const AddRec *l, *r;
+  if (cmp->kind == ValueKind::Binary && cmp->op <= BinaryOp::Le)
+  {
+    l = get(cmp->ops[0], loop);
+    r = get(cmp->ops[1], loop);
+    op = cmp->op;
+  }
+  else
+  {
+    l = get(cmp, loop);
+    r = get(h->parent->parent->getInt(0), loop);
+    op = BinaryOp::NotEq;
+  }
+  if (!l || !r)
+    return false;
+  if (l->ops.size() == 1)
+  {
+    std::swap(l, r);
+    op = SwappedCompare(op);
+  }
+  if (l->ops.size() != 2 || r->ops.size() != 1 || !l->ops[1].isConstant() || l->ops[1].constant == 0)
+    return false;
+  if (!loop->contains(br->blocks[0]))
+    op = NegatedCompare(op);
+  if (op == BinaryOp::Eq)
+    return false;
+  start = l->ops[0];
+  step = l->ops[1].constant;
+  bound = r->ops[0];
+  return true;
+}
+
+bool ScalarEvolution::constantTripCount(Loop *loop, int64_t &count)
+{
+  LinearExpr start, bound;
+  int step;
+  BinaryOp op;
+  if (!exitTest(loop, start, step, op, bound) || !start.isConstant() || !bound.isConstant())
+    return false;
+  int64_t a = start.constant, b = bound.constant, s = step;
+  if (!*FoldBinary(op, a, b))
+  {
+    count = 0;
+    return true;
+  }
+  switch (op)
+  {
+  case BinaryOp::Lt:
+    count = s > 0 ? (b - a + s - 1) / s : -1;
+    break;
+  case BinaryOp::Le:
+    count = s > 0 ? (b - a) / s + 1 : -1;
+    break;
+  case BinaryOp::Gt:
+    count = s < 0 ? (a - b - s - 1) / -s : -1;
+    break;
+  case BinaryOp::Ge:
+    count = s < 0 ? (a - b) / -s + 1 : -1;
+    break;
+  default:
+    count = (b - a) % s == 0 ? (b - a) / s : -1;
+    break;
+  }
+  // the variable must not wrap around before the test fails
+  return count > 0 && a + count * s >= INT_MIN && a + count * s <= INT_MAX;
+}
+
+static Value *Emit(BasicBlock *at, BinaryOp op, Value *l, Value *r)
+{
+  auto &m = *at->parent->parent;
+  if (l->kind == ValueKind::Integer && r->kind == ValueKind::Integer)
+    if (auto v = FoldBinary(op, l->imm, r->imm))
+      return m.getInt(*v);
+  if (op == BinaryOp::Mul && (l->isInt(0) || r->isInt(0)))
+    return m.getInt(0);
+  if (op == BinaryOp::Mul && (l->isInt(1) || r->isInt(1)))
+    return l->isInt(1) ? r : l;
+  if ((op == BinaryOp::Add || op == BinaryOp::Sub) && r->isInt(0))
+    return l;
+  if (op == BinaryOp::Add && l->isInt(0))
+    return r;
+  auto res = m.createBinary(op, l, r);
+  at->insertBeforeTerminator(res);
+  return res;
+}
+
+Value *ScalarEvolution::expand(const LinearExpr &e, BasicBlock *at)
+{
+  auto &m = *at->parent->parent;
+  Value *res = nullptr;
+  for (auto [v, c] : e.terms)
+  {
+    auto term = Emit(at, BinaryOp::Mul, v, m.getInt(c));
+    res = res ? Emit(at, BinaryOp::Add, res, term) : term;
+  }
+  if (!res)
+    return m.getInt(e.constant);
+  return Emit(at, BinaryOp::Add, res, m.getInt(e.constant));
+}
+
+Value *ScalarEvolution::expandTripCount(Loop *loop, BasicBlock *at)
+{
+  auto &m = *at->parent->parent;
+  int64_t count;
+  if (constantTripCount(loop, count))
+    return m.getInt(int(count));
+  LinearExpr start, bound;
+  int step;
+  BinaryOp op;
+  if (!exitTest(loop, start, step, op, bound) || (step != 1 && step != -1))
+    return nullptr;
+  // with a unit step the distance to the bound is the count, if the loop runs at all
+  LinearExpr dist = step == 1 ? bound : start;
+  dist += (step == 1 ? start : bound) * -1;
+  if (op == BinaryOp::NotEq)
+    return expand(dist, at);
+  if ((step == 1) != (op == BinaryOp::Lt || op == BinaryOp::Le))
+    return nullptr;
+  if (op == BinaryOp::Le || op == BinaryOp::Ge)
+    dist.constant = WrapAdd(dist.constant, 1);
+  auto runs = Emit(at, op, expand(start, at), expand(bound, at));
+  return Emit(at, BinaryOp::Mul, expand(dist, at), runs);
+}
+
+Value *ScalarEvolution::expand(const AddRec &r, Value *k, BasicBlock *at)
+{
+  auto &m = *at->parent->parent;
+  if (k->kind == ValueKind::Integer)
+  {
+    // C(k, i) modulo 2^32, the divisions are exact
+    unsigned n = k->imm, c2 = n % 2 == 0 ? n / 2 * (n - 1) : (n - 1) / 2 * n;
+    unsigned binom[] = {1, n, c2, c2 * (n - 2) * 0xAAAAAAABu};
+    LinearExpr sum;
+    for (size_t i = 0; i < r.ops.size(); ++i)
+      sum += r.ops[i] * int(binom[i]);
+    return expand(sum, at);
+  }
+  vector<Value *> binom = {m.getInt(1), k};
+  if (r.ops.size() > 2)
+  {
+    // k * (k - 1) / 2 as (k >> 1) * (k - 1 + (k & 1)), which is exact modulo 2^32
+    auto half = Emit(at, BinaryOp::Shr, k, m.getInt(1));
+    auto odd = Emit(at, BinaryOp::And, k, m.getInt(1));
+    auto other = Emit(at, BinaryOp::Add, Emit(at, BinaryOp::Sub, k, m.getInt(1)), odd);
+    binom.push_back(Emit(at, BinaryOp::Mul, half, other));
+  }
+  if (r.ops.size() > 3)
+  {
+    // C(k, 2) * (k - 2) is 3 * C(k, 3), 0xAAAAAAAB is the inverse of 3 modulo 2^32
+    auto triple = Emit(at, BinaryOp::Mul, binom[2], Emit(at, BinaryOp::Sub, k, m.getInt(2)));
+    binom.push_back(Emit(at, BinaryOp::Mul, triple, m.getInt(int(0xAAAAAAABu))));
+  }
+  Value *res = expand(r.ops[0], at);
+  for (size_t i = 1; i < r.ops.size(); ++i)
+    res = Emit(at, BinaryOp::Add, res, Emit(at, BinaryOp::Mul, expand(r.ops[i], at), binom[i]));
+  return res;
+}
+
+Value *ScalarEvolution::expandExitValue(Value *v, Loop *loop, BasicBlock *at)
+{
+  auto r = get(v, loop);
+  if (!r)
+    return nullptr;
+  auto k = expandTripCount(loop, at);
+  return k ? expand(*r, k, at) : nullptr;
+}
@@ -0,0 +1,148 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+// the address accessed by a load or store, nullptr for other instructions
+static Value *AccessedPointer(Value *inst)
+{
+  if (inst->kind == ValueKind::Load)
+    return inst->ops[0];
+  if (inst->kind == ValueKind::Store)
+    return inst->ops[1];
+  return nullptr;
+}
+
+// whether every access to the memory at ptr in the loop goes through ptr itself,
+// and the loop stores to it on every trip
+static bool CanPromote(DominatorTree &dt, Loop *loop, Value *ptr)
+{
+  if (!loop->isInvariant(ptr) || !ptr->ty->base->isInt() || !IsDereferenceable(ptr))
+    return false;
+  int size = ptr->ty->base->size();
+  auto latches = loop->latches();
+  bool stored = false;
+  for (auto bb : loop->blocks)
+  {
+    bool everyTrip = std::all_of(latches.begin(), latches.end(), [&](BasicBlock *l)
+                                 { return dt.dominates(bb, l); });
+    for (auto inst : bb->insts)
+    {
+      if (inst->kind == ValueKind::Call && (MayRead(inst, ptr, size) || MayClobber(inst, ptr, size)))
+        return false;
+      auto p = AccessedPointer(inst);
+      if (!p)
+        continue;
+      if (p == ptr)
+      {
+        stored |= inst->kind == ValueKind::Store && everyTrip;
+        continue;
+      }
+      int psize = inst->kind == ValueKind::Load ? inst->ty->size() : inst->ops[0]->ty->size();
+      if (MayAlias(p, psize, ptr, size))
+        return false;
+    }
+  }
+  return stored;
+}
+
+// the innermost loop containing both blocks, nullptr if there is none
+static Loop *CommonLoop(LoopInfo &li, BasicBlock *a, BasicBlock *b)
+{
+  auto found = li.loopOf.find(a);
+  auto loop = found == li.loopOf.end() ? nullptr : found->second;
+  while (loop && !loop->contains(b))
+    loop = loop->parent;
+  return loop;
+}
+
+// let the loop work on a local slot, which is filled from ptr in the preheader and
+// written back wherever the loop is left
+static void Promote(LoopInfo &li, Loop *loop, Value *ptr)
+{
+  auto &f = *loop->header->parent;
+  auto &m = *f.parent;
+  auto slot = m.createAlloc(ptr->ty->base);
+  f.entry()->insts.push_front(slot);
+  slot->parent = f.entry();
+  auto ph = loop->preheader();
+  auto init = m.createLoad(ptr);
+  ph->insertBeforeTerminator(init);
+  ph->insertBeforeTerminator(m.createStore(init, slot));
+
+  for (auto bb : loop->blocks)
+    for (auto inst : bb->insts)
+      if (AccessedPointer(inst) == ptr)
+        inst->setOperand(inst->kind == ValueKind::Load ? 0 : 1, slot);
+
+  auto writeBack = [&](BasicBlock *bb, Value *pos)
+  {
+    auto v = m.createLoad(slot);
+    bb->insertBefore(pos, v);
+    bb->insertBefore(pos, m.createStore(v, ptr));
+  };
+  for (auto bb : vector<BasicBlock *>(loop->blocks))
+  {
+    auto t = bb->terminator();
+    if (t->kind == ValueKind::Ret)
+    {
+      writeBack(bb, t);
+      continue;
+    }
+    auto succs = bb->successors();
+    for (size_t i = 0; i < succs.size(); ++i)
+    {
+      auto exit = succs[i];
+      if (loop->contains(exit) || std::find(succs.begin(), succs.begin() + i, exit) != succs.begin() + i)
+        continue;
+      // a block of its own on the exit edge, so other ways into the exit are not affected
+      auto nb = f.newBlock(bb->name + "_exit");
+      nb->push_back(m.createJump(exit));
+      writeBack(nb, nb->terminator());
+      ReplaceSuccessor(bb, exit, nb);
+      ReplacePhiIncoming(exit, bb, nb);
+      if (auto outer = CommonLoop(li, bb, exit))
+        li.addBlock(outer, nb);
+    }
+  }
+  f.buildCFG();
+}
+
+/**
+ * @brief Scalar promotion of memory accessed in loops
+ * @details A loop invariant address which the loop loads and stores, while no
+ * other access or call in the loop may touch the same memory, is loaded once in the
+ * preheader and stored back on every exit. Inside the loop the accesses go through a
+ * new local slot, which Mem2Reg then turns into SSA values, so globals used as
+ * counters or accumulators stay in registers. Only addresses which are always
+ * valid are promoted, as the load in the preheader runs even if the loop body
+ * would not. As every phi costs a store and a load in the backend, the memory
+ * must be written on every trip, or the phis at the joins inside the loop would
+ * cost more than the accesses they replace.
+ */
+bool ScalarPromotion(Function &f)
+{
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    if (!li.insertPreheader(loop))
+      continue;
+    f.buildCFG();
+    vector<Value *> candidates;
+    for (auto bb : loop->blocks)
+      for (auto inst : bb->insts)
+        if (inst->kind == ValueKind::Store &&
+            std::find(candidates.begin(), candidates.end(), inst->ops[1]) == candidates.end())
+          candidates.push_back(inst->ops[1]);
+    for (auto ptr : candidates)
+      if (CanPromote(dt, loop, ptr))
+      {
+        Promote(li, loop, ptr);
+        changed = true;
+      }
+  }
+  if (changed)
+    Mem2Reg(f);
+  return changed;
+}
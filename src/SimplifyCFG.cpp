@@ -0,0 +1,255 @@
+#include "Pass.hpp"
+#include <algorithm>
+#include <optional>
+
+// at most this many single predecessor blocks are walked to find a known condition
+static const int kMaxConditionDepth = 8;
+
+static Value *Incoming(Value *phi, BasicBlock *from)
+{
+  for (size_t i = 0; i < phi->ops.size(); ++i)
+    if (phi->blocks[i] == from)
+      return phi->ops[i];
+  return nullptr;
+}
+
+// drop one incoming value from the block from, for an edge which disappeared
+static void RemoveOneIncoming(BasicBlock *bb, BasicBlock *from)
+{
+  for (auto phi : Phis(bb))
+    for (size_t i = 0; i < phi->blocks.size(); ++i)
+      if (phi->blocks[i] == from)
+      {
+        phi->removeOperand(i);
+        phi->blocks.erase(phi->blocks.begin() + i);
+        break;
+      }
+}
+
+static bool IsTestOf(Value *v, Value *x, BinaryOp op)
+{
+  return v->kind == ValueKind::Binary && v->op == op && v->ops[0] == x && v->ops[1]->isInt(0);
+}
+
+// whether v is nonzero, given that fact is nonzero exactly when truth holds
+static std::optional<bool> Implied(Value *v, Value *fact, bool truth)
+{
+  if (v == fact || IsTestOf(v, fact, BinaryOp::NotEq) || IsTestOf(fact, v, BinaryOp::NotEq))
+    return truth;
+  if (IsTestOf(v, fact, BinaryOp::Eq) || IsTestOf(fact, v, BinaryOp::Eq))
+    return !truth;
+  if (v->kind == ValueKind::Binary && fact->kind == ValueKind::Binary && v->op <= BinaryOp::Le &&
+      fact->op <= BinaryOp::Le && v->ops[0] == fact->ops[0] && v->ops[1] == fact->ops[1])
+  {
+    if (v->op == fact->op)
+      return truth;
+    if (v->op == NegatedCompare(fact->op))
+      return !truth;
+  }
+  return std::nullopt;
+}
+
+// whether v is nonzero on the edge from bb to succ, from the branches leading there
+static std::optional<bool> KnownTruth(Value *v, BasicBlock *bb, BasicBlock *succ)
+{
+  if (v->kind == ValueKind::Integer)
+    return v->imm != 0;
+  for (int depth = 0; bb && depth < kMaxConditionDepth; ++depth)
+  {
+    auto br = bb->terminator();
+    if (br && br->kind == ValueKind::Branch && br->blocks[0] != br->blocks[1])
+      if (auto t = Implied(v, br->ops[0], br->blocks[0] == succ))
+        return t;
+    succ = bb;
+    bb = bb->preds.size() == 1 ? bb->preds[0] : nullptr;
+  }
+  return std::nullopt;
+}
+
+// the direction the branch of bb takes when entered from pred, if known
+static std::optional<bool> EdgeCondition(BasicBlock *bb, BasicBlock *pred)
+{
+  auto cond = bb->terminator()->ops[0];
+  if (cond->kind == ValueKind::Phi && cond->parent == bb)
+    return KnownTruth(Incoming(cond, pred), pred, bb);
+  if (cond->kind == ValueKind::Binary && cond->parent == bb && cond->ops[1]->kind == ValueKind::Integer)
+  {
+    auto l = cond->ops[0];
+    if (l->kind != ValueKind::Phi || l->parent != bb)
+      return std::nullopt;
+    auto in = Incoming(l, pred);
+    if (in->kind == ValueKind::Integer)
+    {
+      auto v = FoldBinary(cond->op, in->imm, cond->ops[1]->imm);
+      return v ? std::optional<bool>(*v != 0) : std::nullopt;
+    }
+    if (cond->ops[1]->isInt(0) && (cond->op == BinaryOp::NotEq || cond->op == BinaryOp::Eq))
+      if (auto t = KnownTruth(in, pred, bb))
+        return cond->op == BinaryOp::NotEq ? *t : !*t;
+    return std::nullopt;
+  }
+  return cond->isInst() && cond->parent == bb ? std::nullopt : KnownTruth(cond, pred, bb);
+}
+
+// a branch on a constant or to the same block twice becomes a jump
+static bool FoldBranch(BasicBlock *bb)
+{
+  auto &m = *bb->parent->parent;
+  auto br = bb->terminator();
+  if (br->kind != ValueKind::Branch)
+    return false;
+  auto t = br->blocks[0], e = br->blocks[1];
+  BasicBlock *target;
+  if (t == e)
+    target = t;
+  else if (br->ops[0]->kind == ValueKind::Integer)
+    target = br->ops[0]->imm ? t : e;
+  else
+    return false;
+  // with both edges to the same block the phis keep their single entry for bb
+  if (t != e)
+    RemoveOneIncoming(target == t ? e : t, bb);
+  bb->erase(br);
+  bb->push_back(m.createJump(target));
+  return true;
+}
+
+// append a block to its only predecessor, which only jumps to it
+static bool MergeIntoPredecessor(BasicBlock *bb)
+{
+  auto &f = *bb->parent;
+  if (bb == f.entry() || bb->preds.size() != 1)
+    return false;
+  auto pred = bb->preds[0];
+  auto jump = pred->terminator();
+  if (pred == bb || jump->kind != ValueKind::Jump)
+    return false;
+  for (auto phi : Phis(bb))
+  {
+    phi->replaceAllUsesWith(phi->ops[0]);
+    bb->erase(phi);
+  }
+  pred->erase(jump);
+  for (auto inst : vector<Value *>(bb->insts.begin(), bb->insts.end()))
+  {
+    bb->remove(inst);
+    pred->push_back(inst);
+  }
+  for (auto s : pred->successors())
+    ReplacePhiIncoming(s, bb, pred);
+  f.removeBlock(bb);
+  return true;
+}
+
+// predecessors of a block which only jumps on go to its target directly
+static bool ForwardEmptyBlock(BasicBlock *bb)
+{
+  auto &f = *bb->parent;
+  auto jump = bb->terminator();
+  if (bb == f.entry() || bb->insts.size() != 1 || jump->kind != ValueKind::Jump)
+    return false;
+  auto target = jump->blocks[0];
+  if (target == bb)
+    return false;
+  auto phis = Phis(target);
+  bool changed = false;
+  for (auto pred : vector<BasicBlock *>(bb->preds))
+  {
+    auto succs = pred->successors();
+    // merging two edges into one needs the phis to agree on them
+    if (std::find(succs.begin(), succs.end(), target) != succs.end() &&
+        std::any_of(phis.begin(), phis.end(), [&](Value *phi)
+                    { return Incoming(phi, pred) != Incoming(phi, bb); }))
+      continue;
+    ReplaceSuccessor(pred, bb, target);
+    for (auto phi : phis)
+    {
+      phi->addOperand(Incoming(phi, bb));
+      phi->blocks.push_back(pred);
+    }
+    changed = true;
+  }
+  if (!changed)
+    return false;
+  f.buildCFG();
+  if (bb->preds.empty())
+  {
+    RemovePhiIncoming(target, bb);
+    f.removeBlock(bb);
+  }
+  return true;
+}
+
+/**
+ * @brief Jump threading
+ * @details A block which only merges values for its branch is skipped by the
+ * predecessors on whose edge the branch direction is known, because they pass in a
+ * constant or because a branch before them tested the same condition.
+ */
+static bool ThreadJumps(BasicBlock *bb)
+{
+  auto br = bb->terminator();
+  if (br->kind != ValueKind::Branch || br->blocks[0] == br->blocks[1])
+    return false;
+  for (auto inst : bb->insts)
+  {
+    if (inst == br)
+      continue;
+    // the values of the block are not computed on the threaded edges
+    if (inst->hasSideEffect() || std::any_of(inst->users.begin(), inst->users.end(), [&](Value *u)
+                                             { return u->parent != bb; }))
+      return false;
+  }
+  bool changed = false;
+  for (auto pred : vector<BasicBlock *>(bb->preds))
+  {
+    auto succs = pred->successors();
+    if (std::count(succs.begin(), succs.end(), bb) != 1)
+      continue;
+    auto taken = EdgeCondition(bb, pred);
+    if (!taken)
+      continue;
+    auto target = *taken ? br->blocks[0] : br->blocks[1];
+    if (target == bb || std::find(succs.begin(), succs.end(), target) != succs.end())
+      continue;
+    for (auto phi : Phis(target))
+    {
+      phi->addOperand(Incoming(phi, bb));
+      phi->blocks.push_back(pred);
+    }
+    RemoveOneIncoming(bb, pred);
+    ReplaceSuccessor(pred, bb, target);
+    bb->parent->buildCFG();
+    changed = true;
+  }
+  return changed;
+}
+
+/**
+ * @brief Simplify the control flow graph
+ * @details Folds branches with a known direction, appends blocks to a predecessor
+ * which only jumps to them, lets jumps through empty blocks go to their target
+ * directly and threads jumps over blocks whose branch direction is known on the
+ * incoming edge. Repeats until nothing changes.
+ */
+bool SimplifyCFG(Function &f)
+{
+  bool changed = false, progress = true;
+  while (progress)
+  {
+    progress = RemoveUnreachableBlocks(f);
+    f.buildCFG();
+    for (auto bb : vector<BasicBlock *>(f.blocks.begin(), f.blocks.end()))
+    {
+      // a removed block has no instructions left, not even a terminator
+      if (bb->insts.empty())
+        continue;
+      bool step = FoldBranch(bb) || MergeIntoPredecessor(bb) || ForwardEmptyBlock(bb) || ThreadJumps(bb);
+      if (step)
+        f.buildCFG();
+      progress |= step;
+    }
+    changed |= progress;
+  }
+  return changed;
+}
@@ -0,0 +1,119 @@
+#include "Pass.hpp"
+#include <algorithm>
+
+// only functions of at most this many instructions are specialized
+static const int kMaxSpecializeSize = 150;
+// no function gets more than this many specialized copies
+static const int kMaxSpecializations = 2;
+// the copies add at most this many instructions to the module
+static const int kMaxGrowth = 1500;
+
+static int Size(Function &f)
+{
+  int size = 0;
+  for (auto bb : f.blocks)
+    size += bb->insts.size();
+  return size;
+}
+
+// whether a constant in place of the parameter lets some instruction fold
+static bool FoldsWithConstant(Value *param)
+{
+  return std::any_of(param->users.begin(), param->users.end(), [](Value *u)
+                     { return u->kind == ValueKind::Binary || u->kind == ValueKind::Branch ||
+                              u->kind == ValueKind::GetElemPtr || u->kind == ValueKind::GetPtr; });
+}
+
+typedef vector<std::optional<int>> Signature;
+
+// the constant arguments of a call which are worth specializing on
+static Signature SignatureOf(Value *call)
+{
+  auto callee = call->callee;
+  Signature sig(callee->params.size());
+  for (size_t i = 0; i < sig.size(); ++i)
+    if (call->ops[i]->kind == ValueKind::Integer && FoldsWithConstant(callee->params[i]))
+      sig[i] = call->ops[i]->imm;
+  return sig;
+}
+
+// a copy of f with the parameters given in sig replaced by their constants
+static Function *Clone(Function &f, const Signature &sig)
+{
+  auto &m = *f.parent;
+  string name = f.name + "_spec";
+  for (int i = 1; m.getFunction(name); ++i)
+    name = f.name + "_spec_" + std::to_string(i);
+  auto g = m.newFunction(name, f.retTy);
+  g->paramTys = f.paramTys;
+  map<Value *, Value *> vmap;
+  for (size_t i = 0; i < f.params.size(); ++i)
+  {
+    auto p = m.create(ValueKind::FuncArg, f.params[i]->ty);
+    p->name = f.params[i]->name;
+    g->params.push_back(p);
+    vmap[f.params[i]] = sig[i] ? m.getInt(*sig[i]) : p;
+  }
+  auto blocks = CloneBlocks(vector<BasicBlock *>(f.blocks.begin(), f.blocks.end()), *g, vmap);
+  blocks.front()->name = "%entry";
+  return g;
+}
+
+/**
+ * @brief Function specialization on constant arguments
+ * @details Calls which pass constants the callee can fold with, while other calls to
+ * the same callee pass something else, go to a copy of the callee with those
+ * constants substituted. Recursive calls within the copy which pass the same
+ * constants go to the copy too. Small callees only, with the most common
+ * argument combinations first and a limit on the growth of the module. When all
+ * calls agree IPSCCP propagates the constants instead.
+ */
+bool Specialize(Module &m)
+{
+  map<Function *, vector<Value *>> calls;
+  for (auto &f : m.funcs)
+    for (auto bb : f->blocks)
+      for (auto inst : bb->insts)
+        if (inst->kind == ValueKind::Call && !inst->callee->isDecl())
+          calls[inst->callee].push_back(inst);
+
+  int growth = 0;
+  bool changed = false;
+  vector<Function *> funcs;
+  for (auto &f : m.funcs)
+    funcs.push_back(f.get());
+  for (auto f : funcs)
+  {
+    int size = Size(*f);
+    if (f->isDecl() || size > kMaxSpecializeSize)
+      continue;
+    map<Signature, vector<Value *>> groups;
+    for (auto call : calls[f])
+      groups[SignatureOf(call)].push_back(call);
+    if (groups.size() < 2)
+      continue;
+    vector<std::pair<Signature, vector<Value *>>> order(groups.begin(), groups.end());
+    std::stable_sort(order.begin(), order.end(), [](auto &a, auto &b)
+                     { return a.second.size() > b.second.size(); });
+    int copies = 0;
+    for (auto &[sig, sites] : order)
+    {
+      if (copies == kMaxSpecializations || growth + size > kMaxGrowth)
+        break;
+      if (std::none_of(sig.begin(), sig.end(), [](auto &c)
+                       { return c.has_value(); }))
+        continue;
+      auto g = Clone(*f, sig);
+      for (auto call : sites)
+        call->callee = g;
+      for (auto bb : g->blocks)
+        for (auto inst : bb->insts)
+          if (inst->kind == ValueKind::Call && inst->callee == f && SignatureOf(inst) == sig)
+            inst->callee = g;
+      growth += size;
+      ++copies;
+      changed = true;
+    }
+  }
+  return changed;
+}
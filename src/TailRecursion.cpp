@@ -0,0 +1,174 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+#include <algorithm>
+
+/**
+ * @brief A return which may become a jump back to the top of the function
+ * @details Either "ret f(args)", or "ret f(args) op x" where op is add or mul, x is
+ * computed before the call and the call is right before the op.
+ */
+struct TailSite
+{
+  Value *call, *op;
+};
+
+static std::optional<TailSite> MatchTailSite(Function &f, Value *ret)
+{
+  auto bb = ret->parent;
+  auto it = bb->find(ret);
+  if (it == bb->insts.begin())
+    return std::nullopt;
+  auto prev = *std::prev(it);
+  auto isSelfCall = [&](Value *v)
+  { return v->kind == ValueKind::Call && v->callee == &f && v->parent == bb && v->users.size() <= 1; };
+  if (isSelfCall(prev) && (ret->ops.empty() || ret->ops[0] == prev))
+    return TailSite{prev, nullptr};
+
+  if (ret->ops.empty() || ret->ops[0] != prev || prev->kind != ValueKind::Binary || prev->users.size() != 1 ||
+      (prev->op != BinaryOp::Add && prev->op != BinaryOp::Mul))
+    return std::nullopt;
+  auto op = prev;
+  it = bb->find(op);
+  if (it == bb->insts.begin())
+    return std::nullopt;
+  auto call = *std::prev(it);
+  if (!isSelfCall(call) || (op->ops[0] != call && op->ops[1] != call) || op->ops[0] == op->ops[1])
+    return std::nullopt;
+  return TailSite{call, op};
+}
+
+/**
+ * @brief Tail recursion elimination with accumulators
+ * @details Self calls whose result is returned right away become jumps back to the
+ * top of the function, with a phi per parameter. Returns of the form f(args) + x or
+ * f(args) * x are handled too: the pending operations are gathered in an accumulator
+ * phi, and every other return combines its value with the accumulator. This is only
+ * done for linear recursion, where no other self call is left. As the frame
+ * is reused, no local array may have its address taken.
+ */
+bool TailRecursionElim(Function &f)
+{
+  auto &m = *f.parent;
+  vector<TailSite> sites;
+  vector<Value *> rets;
+  // the operation of the returns with a pending operation, if there are any
+  auto accOp = BinaryOp::Add;
+  bool accumulate = false;
+  for (auto bb : f.blocks)
+  {
+    auto ret = bb->terminator();
+    if (!ret || ret->kind != ValueKind::Ret)
+      continue;
+    auto site = MatchTailSite(f, ret);
+    if (!site)
+    {
+      rets.push_back(ret);
+      continue;
+    }
+    if (site->op)
+    {
+      if (accumulate && accOp != site->op->op)
+        return false;
+      accOp = site->op->op;
+      accumulate = true;
+    }
+    sites.push_back(*site);
+  }
+  // with self calls left over the recursion is not linear, and the accumulator only
+  // adds phi copies to every remaining call
+  int selfCalls = 0;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      selfCalls += inst->kind == ValueKind::Call && inst->callee == &f;
+  if (accumulate && selfCalls != int(sites.size()))
+  {
+    accumulate = false;
+    for (auto it = sites.begin(); it != sites.end();)
+      if (it->op)
+      {
+        rets.push_back(it->call->parent->terminator());
+        it = sites.erase(it);
+      }
+      else
+        ++it;
+  }
+  if (sites.empty())
+    return false;
+  for (auto bb : f.blocks)
+    for (auto inst : bb->insts)
+      if (inst->kind == ValueKind::Alloc && IsEscaping(inst))
+        return false;
+
+  // the old entry becomes the loop header, a new entry keeps the allocs
+  auto body = f.entry();
+  body->name = m.uniqueLabel("%tail_recurse");
+  auto entry = f.newBlock("%entry");
+  entry->name = "%entry";
+  f.blocks.remove(entry);
+  f.blocks.push_front(entry);
+  for (auto it = body->insts.begin(); it != body->insts.end();)
+  {
+    auto inst = *it++;
+    if (inst->kind != ValueKind::Alloc)
+      continue;
+    body->remove(inst);
+    entry->push_back(inst);
+  }
+  entry->push_back(m.createJump(body));
+
+  vector<Value *> params;
+  for (auto p : f.params)
+  {
+    auto phi = m.createPhi(p->ty);
+    p->replaceAllUsesWith(phi);
+    phi->addOperand(p);
+    phi->blocks.push_back(entry);
+    body->insts.push_front(phi);
+    phi->parent = body;
+    params.push_back(phi);
+  }
+  Value *acc = nullptr;
+  if (accumulate)
+  {
+    acc = m.createPhi(f.retTy);
+    acc->addOperand(m.getInt(accOp == BinaryOp::Add ? 0 : 1));
+    acc->blocks.push_back(entry);
+    body->insts.push_front(acc);
+    acc->parent = body;
+  }
+
+  for (auto [call, op] : sites)
+  {
+    auto bb = call->parent;
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+      params[i]->addOperand(call->ops[i]);
+      params[i]->blocks.push_back(bb);
+    }
+    if (acc)
+    {
+      Value *next = acc;
+      if (op)
+      {
+        auto x = op->ops[0] == call ? op->ops[1] : op->ops[0];
+        next = m.createBinary(accOp, acc, x);
+        bb->insertBefore(call, next);
+      }
+      acc->addOperand(next);
+      acc->blocks.push_back(bb);
+    }
+    bb->erase(bb->terminator());
+    if (op)
+      bb->erase(op);
+    bb->erase(call);
+    bb->push_back(m.createJump(body));
+  }
+  if (acc)
+    for (auto ret : rets)
+    {
+      auto res = m.createBinary(accOp, acc, ret->ops[0]);
+      ret->parent->insertBefore(ret, res);
+      ret->setOperand(0, res);
+    }
+  return true;
+}
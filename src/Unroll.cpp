@@ -0,0 +1,216 @@
+#include "Pass.hpp"
+#include "Analysis.hpp"
+
+// loops whose whole unrolled body stays within this many instructions are unrolled fully
+static const int kFullUnrollSize = 256;
+// only loops of at most this many instructions are unrolled partially
+static const int kPartialUnrollSize = 60;
+// no function grows by more than this many instructions through unrolling
+static const int kMaxGrowth = 2000;
+
+/**
+ * @brief A copy of one trip through a loop
+ * @details entry is the copy of the header and latch jumps back to it, next holds
+ * the values of the header phis for the following trip.
+ */
+struct Iteration
+{
+  BasicBlock *entry, *latch;
+  map<Value *, Value *> next;
+};
+
+// copy the blocks of the loop for a trip which passes the header test, the header
+// phis taking the values in vals
+static Iteration CloneIteration(Loop *loop, const map<Value *, Value *> &vals)
+{
+  auto h = loop->header;
+  auto &m = *h->parent->parent;
+  auto latch = loop->latches()[0];
+  map<Value *, Value *> vmap;
+  auto blocks = CloneBlocks(loop->blocks, *h->parent, vmap);
+  map<BasicBlock *, BasicBlock *> bmap;
+  for (size_t i = 0; i < blocks.size(); ++i)
+    bmap[loop->blocks[i]] = blocks[i];
+
+  Iteration res{bmap[h], bmap[latch], {}};
+  for (auto [phi, v] : vals)
+  {
+    Value *in = nullptr;
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (phi->blocks[i] == latch)
+        in = phi->ops[i];
+    if (vals.count(in))
+      res.next[phi] = vals.at(in);
+    else
+      res.next[phi] = vmap.count(in) ? vmap[in] : in;
+  }
+  for (auto [phi, v] : vals)
+  {
+    vmap[phi]->replaceAllUsesWith(v);
+    res.entry->erase(vmap[phi]);
+  }
+  auto br = h->terminator();
+  auto body = loop->contains(br->blocks[0]) ? br->blocks[0] : br->blocks[1];
+  res.entry->erase(res.entry->terminator());
+  res.entry->push_back(m.createJump(bmap[body]));
+  return res;
+}
+
+static int Size(Loop *loop)
+{
+  int size = 0;
+  for (auto bb : loop->blocks)
+    size += bb->insts.size();
+  return size;
+}
+
+// replace the loop by count copies of its body followed by the final header test
+static void FullyUnroll(Loop *loop, int64_t count)
+{
+  auto h = loop->header, ph = loop->preheader();
+  auto &m = *h->parent->parent;
+  map<Value *, Value *> vals;
+  auto phis = Phis(h);
+  for (auto phi : phis)
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (phi->blocks[i] == ph)
+        vals[phi] = phi->ops[i];
+
+  BasicBlock *from = ph, *to = h;
+  for (int64_t i = 0; i < count; ++i)
+  {
+    auto it = CloneIteration(loop, vals);
+    ReplaceSuccessor(from, to, it.entry);
+    from = it.latch;
+    to = it.entry;
+    vals = it.next;
+  }
+  ReplaceSuccessor(from, to, h);
+  for (auto phi : phis)
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (phi->blocks[i] == ph)
+      {
+        phi->setOperand(i, vals[phi]);
+        phi->blocks[i] = from;
+      }
+
+  // the test fails now, the old body is left unreachable
+  auto br = h->terminator();
+  auto body = loop->contains(br->blocks[0]) ? br->blocks[0] : br->blocks[1];
+  auto exit = body == br->blocks[0] ? br->blocks[1] : br->blocks[0];
+  RemovePhiIncoming(body, h);
+  h->erase(br);
+  h->push_back(m.createJump(exit));
+}
+
+// run factor copies of the body per trip of a new loop while at least factor trips
+// remain, the original loop runs the rest
+static void PartiallyUnroll(Loop *loop, Value *count, int factor)
+{
+  auto h = loop->header, ph = loop->preheader();
+  auto &f = *h->parent;
+  auto &m = *f.parent;
+  // the count may exceed INT_MAX for a != test, so round it down with a mask
+  Value *trips = m.createBinary(BinaryOp::And, count, m.getInt(-factor));
+  ph->insertBeforeTerminator(trips);
+
+  auto uh = f.newBlock(h->name + "_unrolled");
+  map<Value *, Value *> vals;
+  auto phis = Phis(h);
+  for (auto phi : phis)
+  {
+    auto up = m.createPhi(phi->ty);
+    for (size_t i = 0; i < phi->ops.size(); ++i)
+      if (phi->blocks[i] == ph)
+      {
+        up->addOperand(phi->ops[i]);
+        phi->setOperand(i, up);
+        phi->blocks[i] = uh;
+      }
+    up->blocks.push_back(ph);
+    uh->push_back(up);
+    vals[phi] = up;
+  }
+  auto counter = m.createPhi(Type::getInt32());
+  counter->addOperand(m.getInt(0));
+  counter->blocks.push_back(ph);
+  uh->push_back(counter);
+  auto test = m.createBinary(BinaryOp::NotEq, counter, trips);
+  uh->push_back(test);
+
+  BasicBlock *from = nullptr, *to = nullptr, *first = nullptr;
+  auto upVals = vals;
+  for (int i = 0; i < factor; ++i)
+  {
+    auto it = CloneIteration(loop, vals);
+    if (from)
+      ReplaceSuccessor(from, to, it.entry);
+    else
+      first = it.entry;
+    from = it.latch;
+    to = it.entry;
+    vals = it.next;
+  }
+  ReplaceSuccessor(from, to, uh);
+  uh->push_back(m.createBranch(test, first, h));
+  for (auto phi : phis)
+  {
+    upVals[phi]->addOperand(vals[phi]);
+    upVals[phi]->blocks.push_back(from);
+  }
+  auto next = m.createBinary(BinaryOp::Add, counter, m.getInt(factor));
+  from->insertBeforeTerminator(next);
+  counter->addOperand(next);
+  counter->blocks.push_back(from);
+  ReplaceSuccessor(ph, h, uh);
+}
+
+/**
+ * @brief Unroll innermost loops with a known trip count
+ * @details Loops with a constant trip count are unrolled fully if the copies fit in
+ * a size budget. Short loops whose trip count can be computed before they start are
+ * unrolled by the configured factor, a remainder loop running the trips left over.
+ * Either way the header test only runs once per group of trips.
+ */
+bool Unroll(Function &f)
+{
+  int factor = GetOptConfig().unrollFactor;
+  // the remainder is split off with a mask, so the factor is a power of two
+  while (factor & (factor - 1))
+    factor &= factor - 1;
+  DominatorTree dt(f);
+  LoopInfo li(f, dt);
+  ScalarEvolution se;
+  int growth = 0;
+  bool changed = false;
+  for (auto loop : li.postOrder())
+  {
+    if (!loop->subLoops.empty() || !li.insertPreheader(loop))
+      continue;
+    int size = Size(loop);
+    int64_t count;
+    if (se.constantTripCount(loop, count))
+    {
+      if (count * size <= kFullUnrollSize && growth + count * size <= kMaxGrowth)
+      {
+        FullyUnroll(loop, count);
+        growth += count * size;
+        changed = true;
+        continue;
+      }
+      if (count < factor)
+        continue;
+    }
+    if (factor < 2 || size > kPartialUnrollSize || growth + factor * size > kMaxGrowth)
+      continue;
+    auto k = se.expandTripCount(loop, loop->preheader());
+    if (!k)
+      continue;
+    PartiallyUnroll(loop, k, factor);
+    growth += factor * size;
+    changed = true;
+  }
+  if (changed)
+    RemoveUnreachableBlocks(f);
+  return changed;
+}
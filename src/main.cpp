@@ -9,6 +9,7 @@
 #include <bits/stdc++.h>
 #include <string>
 #include "RISCV.h"
+#include "Pass.hpp"
 
 using namespace std;
 
@@ -28,10 +29,11 @@ int main(int argc, const char *argv[])
 #endif
   // 解析命令行参数. 测试脚本/评测平台要求你的编译器能接收如下参数:
   // compiler 模式 输入文件 -o 输出文件
-  if (argc != 5)
+  if (argc < 5)
   {
-    fmt::print("usage: compiler mode input -o output");
+    fmt::print("usage: compiler mode input -o output [-O0]");
   }
+  ParseOptArgs(argc, argv);
   auto mode = argv[1];
   auto input = argv[2];
   auto output = argv[4];
@@ -47,6 +49,8 @@ int main(int argc, const char *argv[])
   auto yyout = fopen(output, "w");
 
   auto ir = fmt::format("{}", *ast);
+  if (GetOptConfig().enabled)
+    ir = OptimizeIR(ir);
 
   if (string(mode) == "-koopa")
   {
@@ -0,0 +1,29 @@
+int main() {
+  int n = getint();
+  int i = 0;
+  int s = 0;
+  while (i < n) {
+    s = s + i * 3;
+    i = i + 1;
+  }
+  int j = 1;
+  int t = 0;
+  while (j < n) {
+    t = t + j * j;
+    j = j + 1;
+  }
+  int k = 0;
+  int u = 0;
+  while (k < n) {
+    if (n > 50) u = u + k;
+    else u = u - k;
+    k = k + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(t);
+  putch(32);
+  putint(u);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,33 @@
+int weights[4] = {3, 1, 4, 1};
+int scale[3] = {10, 100, 1000};
+int steps[2][2] = {1, 2, 3, 4};
+
+// writes through its parameter, so the arrays passed here are not constant
+void bump(int a[], int i) {
+  a[i] = a[i] + 1;
+}
+
+// only reads its parameter
+int pick(int a[], int i) {
+  return a[i];
+}
+
+int main() {
+  int n = getint();
+  int s = 0;
+  int i = 0;
+  while (i < 4) {
+    // constant offsets once unrolled
+    s = s + weights[i] * scale[i % 3];
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  if (n > 2) {
+    bump(weights, 2);
+    bump(steps[1], 0);
+  }
+  putint(weights[2] * scale[1] + pick(scale, 2) + steps[1][0] + pick(steps[1], 0));
+  putch(10);
+  return weights[2] + steps[1][0];
+}
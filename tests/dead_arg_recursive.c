@@ -0,0 +1,35 @@
+int trace;
+
+// tag is only passed along to the recursive calls, and no caller uses the result
+int visit(int a[], int n, int tag) {
+  if (n <= 0) return tag;
+  trace = trace * 7 % 1000003 + a[n - 1];
+  visit(a, n - 1, tag);
+  if (n % 3 == 0) visit(a, n / 3, tag);
+  return tag + 1;
+}
+
+// lo and hi trade places on the recursive call, so they are not passed unchanged
+int zigzag(int n, int lo, int hi) {
+  if (n == 0) return lo * 10 + hi;
+  return zigzag(n - 1, hi, lo);
+}
+
+int main() {
+  int a[30];
+  int n = getint();
+  int i = 0;
+  while (i < n) {
+    a[i] = i * i % 17;
+    i = i + 1;
+  }
+  // the dropped argument still has to be read from the input
+  visit(a, n, getint());
+  putint(trace);
+  putch(32);
+  putint(getint());
+  putch(32);
+  putint(zigzag(n, 1, 2));
+  putch(10);
+  return trace % 256;
+}
@@ -0,0 +1,44 @@
+int g[8];
+int last;
+
+void show(int a[], int n) {
+  int i = 0;
+  while (i < n) {
+    putint(a[i]);
+    putch(32);
+    i = i + 1;
+  }
+  putch(10);
+}
+
+int main() {
+  int x = getint();
+  int a[8] = {};
+  // overwritten before any read
+  g[1] = 10;
+  g[1] = x;
+  last = 1;
+  // read through the call, so the first store stays
+  a[2] = x * 2;
+  show(a, 4);
+  a[2] = x * 3;
+  // overwritten on one path only
+  g[3] = 7;
+  if (x > 5) {
+    g[3] = 8;
+  }
+  // a local array that is not read again before the return
+  int t[4] = {};
+  t[0] = x;
+  t[1] = t[0] + 1;
+  // overwritten piece by piece in the same block
+  g[4] = 1;
+  g[5] = 2;
+  g[4] = t[1];
+  g[5] = t[1] + 1;
+  last = 2;
+  a[3] = a[2] + t[1];
+  show(g, 8);
+  show(a, 4);
+  return last;
+}
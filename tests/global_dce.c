@@ -0,0 +1,48 @@
+int unused[1000];
+int written;
+int table[5] = {5, 4, 3, 2, 1};
+int buffer[8];
+
+int next() {
+  return getint();
+}
+
+// never called from main, though it calls a live function
+int orphan() {
+  unused[3] = next();
+  return unused[3] + table[0];
+}
+
+int sum(int a[], int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s + a[i];
+    i = i + 1;
+  }
+  return s;
+}
+
+void fill(int a[], int v) {
+  a[v % 8] = v;
+}
+
+int main() {
+  int n = getint();
+  // written but never read, the reads of the input must stay
+  written = next() + next();
+  written = written + 1;
+  int i = 0;
+  while (i < n) {
+    // only read through the callee
+    fill(buffer, next());
+    i = i + 1;
+  }
+  putint(sum(buffer, 8));
+  putch(32);
+  putint(sum(table, n % 6));
+  putch(32);
+  putint(next());
+  putch(10);
+  return 0;
+}
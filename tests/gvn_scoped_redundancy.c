@@ -0,0 +1,35 @@
+int a[10];
+
+int main() {
+  int x = getint();
+  int y = getint();
+  int p = x * y + 7;
+  int q = y * x + 7;
+  int r = 0;
+  if (x > y) {
+    r = (x - y) * (x - y);
+    a[x % 10] = r;
+  } else {
+    // the difference of the other branch is not available here
+    r = (y - x) * 3 + (x - y);
+    a[y % 10] = r;
+  }
+  int s = (x - y) * (x - y);
+  int t = 2147483647 + (x - x) + 1;
+  a[(x + y) % 10] = a[(y + x) % 10] + p;
+  putint(p);
+  putch(32);
+  putint(q);
+  putch(32);
+  putint(r);
+  putch(32);
+  putint(s);
+  putch(32);
+  putint(t);
+  putch(32);
+  putint(a[(x + y) % 10]);
+  putch(32);
+  putint(a[x % 10] + a[y % 10]);
+  putch(10);
+  return (p - q) + s % 7;
+}
@@ -0,0 +1,49 @@
+int count;
+
+int clamp(int x, int lo, int hi) {
+  if (x < lo) return lo;
+  if (x > hi) return hi;
+  return x;
+}
+
+// a local array, which must start out zeroed on every call
+int window(int a[], int k) {
+  int w[4] = {};
+  int i = 0;
+  while (i < k) {
+    w[i % 4] = w[i % 4] + a[i];
+    i = i + 1;
+  }
+  count = count + 1;
+  return w[0] * 1000 + w[1] * 100 + w[2] * 10 + w[3];
+}
+
+void bump(int a[], int i) {
+  if (i < 0) return;
+  a[i] = a[i] + clamp(i * 3, 2, 9);
+}
+
+// recursive, never inlined
+int even(int n) {
+  if (n <= 0) return 1;
+  return 1 - even(n - 1);
+}
+
+int main() {
+  int a[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  int n = getint();
+  int s = 0;
+  int i = -1;
+  while (i < n) {
+    bump(a, i);
+    s = s + window(a, clamp(i, 0, 8)) + even(i + 1);
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(count);
+  putch(32);
+  putint(a[3]);
+  putch(10);
+  return clamp(s, 0, 255);
+}
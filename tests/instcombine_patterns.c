@@ -0,0 +1,39 @@
+int main() {
+  int k = getint();
+  int s = 0;
+  while (k > 0) {
+    int x = getint();
+    int y = getint();
+    // constants gather on the right and fold, wrapping around
+    int a = 3 + (x + 2147483647) + 10 - (7 - y);
+    int b = (0 - x) * (0 - y) + (-1) * x - x / -1 + (x - x) * y;
+    int c = ((x * 4) * 5) % 1 + (x * 4) * -5 + x % -1 + y / 1 * 1;
+    // booleans compared against 0 and 1
+    int d = (x > y) == 0;
+    int e = ((x == y) != 1) + !(!(x < 0)) * 10 + (!(y != 3) == 1) * 100;
+    int f = (x + 5 == 3) * 1000 + (0 - x == 4) * 10000 + (x - y == 0) * 100000;
+    int g = (((x < y) && (y < 10)) || (x == 7)) * 3 + ((x < y) == 0 && !(x >= y) == 0);
+    if (!(x - y)) {
+      s = s + 1;
+    }
+    if ((x == 2) == 0) {
+      s = s + 2;
+    }
+    putint(a);
+    putch(32);
+    putint(b);
+    putch(32);
+    putint(c);
+    putch(32);
+    putint(d);
+    putch(32);
+    putint(e);
+    putch(32);
+    putint(f);
+    putch(32);
+    putint(g);
+    putch(10);
+    k = k - 1;
+  }
+  return s;
+}
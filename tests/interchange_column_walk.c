@@ -0,0 +1,33 @@
+int a[64][64];
+int b[64][64];
+
+int main() {
+  int n = getint();
+  int i = 0;
+  // the inner loop walks down the columns, the loops are swapped
+  while (i < 64) {
+    int j = 0;
+    while (j < 64) {
+      a[j][i] = i * n + j;
+      b[j][i] = b[j][i] + a[j][i] % 7;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  // a sum carried through both loops
+  int s = 0;
+  i = 0;
+  while (i < 64) {
+    int j = 0;
+    while (j < 64) {
+      s = s + a[j][i] * (j + 1) - b[j][i];
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(a[5][63] + b[63][5]);
+  putch(10);
+  return s % 256;
+}
@@ -0,0 +1,39 @@
+int a[32][32];
+
+int main() {
+  int n = getint();
+  int i = 0;
+  while (i < 32) {
+    int j = 0;
+    while (j < 32) {
+      a[i][j] = (i * 32 + j) % n;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  // a[i][j] needs a[i - 1][j + 1] from the trip before in the outer loop and after
+  // in the inner one, a (<,>) dependence that rules out the swap, which the column
+  // walk would otherwise call for
+  int j = 0;
+  while (j < 31) {
+    i = 1;
+    while (i < 32) {
+      a[i][j] = a[i - 1][j + 1] * 3 + a[i][j];
+      i = i + 1;
+    }
+    j = j + 1;
+  }
+  int h = 0;
+  i = 0;
+  while (i < 32) {
+    j = 0;
+    while (j < 32) {
+      h = h * 17 + a[i][j];
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  putint(h);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,29 @@
+int a[8][8];
+
+int main() {
+  int i = 0;
+  while (i < 8) {
+    // the guard tests the outer variable, which must not become the inner one
+    if (i) {
+      int j = 0;
+      while (j < 8) {
+        a[j][i] = i * 10 + j;
+        j = j + 1;
+      }
+    }
+    i = i + 1;
+  }
+  int h = 0;
+  i = 0;
+  while (i < 8) {
+    int j = 0;
+    while (j < 8) {
+      h = h * 31 + a[i][j];
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  putint(h);
+  putch(10);
+  return 0;
+}
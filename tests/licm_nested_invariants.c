@@ -0,0 +1,42 @@
+int g[8];
+int h[8];
+
+void touch(int k) {
+  h[k] = h[k] + 1;
+}
+
+int main() {
+  int n = getint();
+  int d = getint();
+  int k = getint();
+  int i = 0;
+  while (i < 8) {
+    g[i] = i * i;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < n) {
+      // invariant in both loops
+      s = s + g[k] * 3 + n * d;
+      // must stay under its condition, d is zero
+      if (d != 0) {
+        s = s + 100 / d;
+      }
+      // h changes in the loop, its loads stay inside
+      s = s + h[k];
+      touch(k);
+      j = j + 1;
+    }
+    // invariant in the outer loop only after the inner one ran
+    s = s + g[(k + 1) % 8] * i;
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(h[k]);
+  putch(10);
+  return s % 256;
+}
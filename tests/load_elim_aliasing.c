@@ -0,0 +1,51 @@
+int g[10];
+int total;
+
+void record(int v) {
+  total = total + v;
+  g[v % 10] = g[v % 10] + 1;
+}
+
+// a and b may be the same array, so a store through b changes a
+int mix(int a[], int b[], int i, int j) {
+  int x = a[i];
+  b[j] = x + 5;
+  int y = a[i];
+  a[i + 1] = 7;
+  int z = a[i];
+  return x * 100 + y * 10 + z;
+}
+
+int main() {
+  int i = getint();
+  int j = getint();
+  int a[10] = {};
+  int b[10] = {};
+  putint(mix(a, a, i, j));
+  putch(32);
+  putint(mix(a, b, i, j));
+  putch(32);
+  // stored values forwarded to loads, on both sides of a branch
+  g[i] = 3;
+  if (j > 2) {
+    g[j] = 4;
+  } else {
+    g[i] = 5;
+  }
+  int s = g[i] * 10;
+  // a call writes g, its loads are not kept across it
+  record(g[i]);
+  s = s + g[i] + g[(g[i] + 0) % 10] + total;
+  // a loop writes g, the header can not assume anything from before it
+  int k = 0;
+  while (k < j) {
+    s = s + g[i];
+    g[i] = g[i] + k;
+    k = k + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(g[i]);
+  putch(10);
+  return s % 256;
+}
@@ -0,0 +1,33 @@
+// the fill of a is split off the summing loop, and both parts are followed by
+// another loop, which runs over other trips so that fusion leaves them apart
+int a[100];
+int b[100];
+int main() {
+  int n = getint();
+  int i = 0;
+  while (i < 100) {
+    b[i] = i * 3 - 20;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < n) {
+    a[i] = 7;
+    s = s + b[i];
+    i = i + 1;
+  }
+  int t = 0;
+  i = 1;
+  while (i < n) {
+    if (b[i] > 0) t = t + a[i] * i;
+    else t = t - a[i];
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(t);
+  putch(32);
+  putint(a[n - 1] + a[n]);
+  putch(10);
+  return s % 256;
+}
@@ -0,0 +1,47 @@
+// fills and copies of constant and runtime length, the runtime ones bounded by
+// n <= 0 must not run at all, and a loop reading the arrays follows
+int g[40];
+int main() {
+  int n = getint();
+  int m = getint();
+  int a[40];
+  int b[40] = {1, 2};
+  int i = 0;
+  while (i < 40) {
+    a[i] = 5;
+    i = i + 1;
+  }
+  i = 0;
+  while (i < 12) {
+    g[i] = a[i];
+    i = i + 1;
+  }
+  i = 0;
+  while (i < n) {
+    a[i] = n;
+    i = i + 1;
+  }
+  int j = 1;
+  while (j < n) {
+    b[j + 2] = g[j];
+    j = j + 1;
+  }
+  i = 3;
+  while (i < m) {
+    b[i] = a[i + 10];
+    i = i + 1;
+  }
+  int s = 0;
+  int k = 0;
+  while (k < 40) {
+    s = s + a[k] * (k + 1) + b[k] * 3 + g[k];
+    k = k + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(i + j);
+  putch(32);
+  putint(b[1] + b[2] + b[3] + b[m]);
+  putch(10);
+  return 0;
+}
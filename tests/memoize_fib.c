@@ -0,0 +1,42 @@
+int bias;
+
+int fib(int n) {
+  if (n < 2) return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+// two keys, whose slots collide for offsets differing by a multiple of the table size
+int walk(int n, int k) {
+  if (n < 2) return n + k;
+  return walk(n - 1, k) + walk(n - 2, k) % 1000;
+}
+
+// reads a global that changes between calls, so it is not memoized
+int shifted(int n) {
+  if (n < 2) return n + bias;
+  return shifted(n - 1) + shifted(n - 2);
+}
+
+int main() {
+  int n = getint();
+  int k = getint();
+  putint(fib(n));
+  putch(32);
+  putint(fib(n - 3));
+  putch(32);
+  putint(fib(-4));
+  putch(32);
+  putint(walk(n, k));
+  putch(32);
+  putint(walk(n, k + 1024));
+  putch(32);
+  putint(walk(n - 1, k));
+  putch(32);
+  bias = 1;
+  putint(shifted(15));
+  putch(32);
+  bias = 2;
+  putint(shifted(15));
+  putch(10);
+  return fib(n) % 256;
+}
@@ -0,0 +1,66 @@
+int g[16];
+int h[16];
+int counter;
+
+// the callees recurse without tail calls, so the calls stay
+
+// reads g only
+int peek(int i) {
+  if (i <= 0) return g[0];
+  return g[i % 16] * 2 - peek(i - 1);
+}
+
+// writes its parameter, which is h in one call and a local array in another
+void store(int a[], int i, int v) {
+  a[i % 16] = v;
+  if (i > 16) {
+    store(a, i - 16, v + 1);
+    a[i % 16] = a[i % 16] - 1;
+  }
+}
+
+// writes h through a chain of calls
+void spread(int n) {
+  if (n <= 0) return;
+  spread(n - 2);
+  h[n % 16] = h[n % 16] + n;
+}
+
+// only counts, touches neither array
+void tick(int n) {
+  if (n <= 0) return;
+  tick(n - 1);
+  counter = counter + 1;
+}
+
+int main() {
+  int n = getint();
+  int local[16] = {};
+  int i = 0;
+  while (i < 16) {
+    g[i] = i * 3;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < n) {
+    // g and local stay the same over the calls, h does not
+    s = s + g[5] + local[2] + h[3];
+    tick(1);
+    s = s + peek(i) + g[5] + h[3];
+    store(h, 3, i);
+    s = s + h[3] + local[2];
+    store(local, 18, i * 2);
+    s = s + local[2];
+    spread(i);
+    s = s + h[(i + 1) % 16] + g[5] + local[2];
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(counter);
+  putch(32);
+  putint(h[1] + h[2] + h[3] + local[2]);
+  putch(10);
+  return s % 256;
+}
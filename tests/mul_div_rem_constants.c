@@ -0,0 +1,22 @@
+int main() {
+  int n = getint();
+  int h = 0;
+  while (n > 0) {
+    int x = getint();
+    // powers of two, their neighbours, sums of two powers and other constants,
+    // positive and negative
+    putint(x * 8 + x * 9 - x * 7 + x * 10 - x * 100 + x * -16 + x * 12345);
+    putch(32);
+    putint(x / 1 + x / -1 + x / 2 + x / -8 + x / 65536 + x / 3 + x / 7);
+    putch(32);
+    putint(x / -5 + x / 10 + x / 641 + x / -1000 + x / 2147483647 + x / -2147483647);
+    putch(32);
+    putint(x % 1 + x % -1 + x % 2 + x % -4 + x % 4096 + x % 65536);
+    putch(32);
+    putint(x % 3 + x % -7 + x % 10 + x % 641 + x % 1000000007);
+    putch(10);
+    h = h * 31 + x % 97 + x / 13;
+    n = n - 1;
+  }
+  return h % 256;
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# usage: run.sh compiler case.c [options]
+# compile a test program, run it under QEMU with case.in as input and compare its
+# output, followed by the exit code, with case.out; options in case.args are passed
+# to the compiler before the given ones
+set -e
+compiler=$1
+src=$2
+shift 2
+case=${src%.c}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+args=
+if [ -f "$case.args" ]; then
+  args=$(cat "$case.args")
+fi
+"$compiler" -riscv "$src" -o "$dir/case.S" $args "$@"
+clang "$dir/case.S" -c -o "$dir/case.o" -target riscv32-unknown-linux-elf -march=rv32im -mabi=ilp32
+ld.lld "$dir/case.o" -L"$CDE_LIBRARY_PATH/riscv32" -lsysy -o "$dir/case"
+
+input=/dev/null
+if [ -f "$case.in" ]; then
+  input=$case.in
+fi
+set +e
+qemu-riscv32-static "$dir/case" < "$input" > "$dir/out"
+ret=$?
+set -e
+if [ -n "$(tail -c1 "$dir/out")" ]; then
+  echo >> "$dir/out"
+fi
+echo $ret >> "$dir/out"
+diff -u "$case.out" "$dir/out"
@@ -0,0 +1,38 @@
+int sum;
+int hits[4];
+
+// the loop can be left by the return as well as by its test, and the promoted
+// global must be written back on both ways out
+int scan(int a[], int n, int stop) {
+  int i = 0;
+  while (i < n) {
+    sum = sum + a[i];
+    hits[a[i] % 4] = hits[a[i] % 4] + 1;
+    if (a[i] == stop) {
+      return i;
+    }
+    i = i + 1;
+  }
+  return -1;
+}
+
+int main() {
+  int a[20];
+  int n = getint();
+  int i = 0;
+  while (i < n) {
+    a[i] = getint();
+    i = i + 1;
+  }
+  putint(scan(a, n, 9));
+  putch(32);
+  putint(sum);
+  putch(32);
+  putint(scan(a, n, 100));
+  putch(32);
+  putint(sum);
+  putch(32);
+  putint(hits[0] * 1000 + hits[1] * 100 + hits[2] * 10 + hits[3]);
+  putch(10);
+  return sum % 256;
+}
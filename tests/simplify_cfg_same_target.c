@@ -0,0 +1,15 @@
+// the empty inner if leaves a branch to the same block twice, folding it into a
+// jump must keep the value of x flowing in from that block
+int main() {
+  int n = getint();
+  int x = 0;
+  if (n > 3) {
+    x = n * 2;
+    if (n) {}
+  } else {
+    x = 5;
+  }
+  putint(x);
+  putch(10);
+  return 0;
+}
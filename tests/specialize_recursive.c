@@ -0,0 +1,37 @@
+int depth;
+
+// recursive, called with mode 1 from several places and with a read mode once, so
+// a copy for mode 1 calls itself
+int walk(int n, int mode) {
+  if (n <= 0) return mode;
+  if (mode == 1) return walk(n - 1, mode) * 3 % 1000003 + n;
+  if (mode == 2) return walk(n - 2, mode) + walk(n - 1, mode) % 7;
+  return walk(n - 1, mode) - n;
+}
+
+// every call passes the same scale, and it always returns 0
+int scaled(int x, int scale) {
+  depth = depth + x * scale;
+  return 0;
+}
+
+int main() {
+  int mode = getint();
+  int n = getint();
+  int s = walk(n, 1) + walk(n + 3, 1) + walk(n / 2, 1);
+  s = s + walk(n, mode);
+  int i = 0;
+  while (i < 4) {
+    s = s + scaled(i, 5) + scaled(s % 10, 5);
+    i = i + 1;
+  }
+  if (mode > 100) {
+    // never runs for the input, but the solver can not know that
+    s = s + scaled(1, 5);
+  }
+  putint(s);
+  putch(32);
+  putint(depth);
+  putch(10);
+  return s % 256;
+}
@@ -0,0 +1,34 @@
+// after inlining the array of the caller is only accessed at constant indices
+int dot3(int a[], int b[]) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+int main() {
+  int n = getint();
+  int s = 0;
+  int k = 0;
+  while (k < n) {
+    // zeroed again on every trip, with a partial initializer
+    int m[2][3] = {1, 0, 0, 2};
+    m[0][0] = k;
+    m[0][1] = k + m[0][0];
+    int v[3] = {};
+    v[k % 2] = 5;
+    m[1][2] = m[0][1] * 3;
+    int w[3];
+    int u[3];
+    w[0] = m[0][0];
+    w[1] = m[0][1];
+    w[2] = m[1][2];
+    u[0] = m[1][0];
+    u[1] = m[1][1];
+    u[2] = m[0][2];
+    s = s + dot3(w, u) + dot3(w, w) + m[1][1];
+    // accessed at a dynamic index, so it stays in memory
+    s = s * 2 + v[k % 3];
+    k = k + 1;
+  }
+  putint(s);
+  putch(10);
+  return s % 256;
+}
@@ -0,0 +1,24 @@
+int a[300];
+
+int main() {
+  int n = getint();
+  int i = 0;
+  // the counter only feeds the multiplications and the exit test
+  while (i < 100) {
+    a[i * 3 % 300] = i * n + i * 3;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  // the counter is also passed to a call, so it stays
+  while (i < 90) {
+    s = s + a[i * 3] * 5 + i * 7;
+    putint(i);
+    putch(32);
+    i = i + 1;
+  }
+  putch(10);
+  putint(s);
+  putch(10);
+  return s % 256;
+}
@@ -0,0 +1,53 @@
+int calls;
+
+// a sum with a pending addition on the recursive call
+int sum(int a[], int n) {
+  if (n == 0) return 0;
+  return a[n - 1] + sum(a, n - 1);
+}
+
+// a pending multiplication, with a second return that takes the accumulator
+int fact(int n, int m) {
+  if (n <= 1) {
+    if (m > 0) return m;
+    return 1;
+  }
+  return fact(n - 1, m) * n;
+}
+
+// a plain tail call, the counter must be updated on every trip
+int gcd(int a, int b) {
+  calls = calls + 1;
+  if (b == 0) return a;
+  return gcd(b, a % b);
+}
+
+// two self calls, so no accumulator, only the tail call becomes a jump
+int fib(int n) {
+  if (n < 2) return n;
+  if (n > 100) return fib(n - 1);
+  return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+  int a[200];
+  int n = getint();
+  int i = 0;
+  while (i < n) {
+    a[i] = i * i - 50;
+    i = i + 1;
+  }
+  putint(sum(a, n));
+  putch(32);
+  putint(fact(10, 0));
+  putch(32);
+  putint(fact(12, 3));
+  putch(32);
+  putint(gcd(1071 * n, 462 * n));
+  putch(32);
+  putint(calls);
+  putch(32);
+  putint(fib(20));
+  putch(10);
+  return fact(5, 0) % 256;
+}
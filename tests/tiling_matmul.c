@@ -0,0 +1,47 @@
+int a[40][40];
+int b[40][40];
+int c[40][40];
+
+int main() {
+  int n = getint();
+  int i = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < n) {
+      a[i][j] = (i * 7 + j * 3) % 11 - 5;
+      b[i][j] = (i * 5 + j * 2) % 13 - 6;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  // i-k-j order, the rows of b come back on every trip of i and the j loop is tiled,
+  // with a last tile shorter than the others as n is not a multiple of the tile size
+  i = 0;
+  while (i < n) {
+    int k = 0;
+    while (k < n) {
+      int j = 0;
+      while (j < n) {
+        c[i][j] = c[i][j] + a[i][k] * b[k][j];
+        j = j + 1;
+      }
+      k = k + 1;
+    }
+    i = i + 1;
+  }
+  int h = 0;
+  i = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < n) {
+      h = h * 31 + c[i][j];
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  putint(h);
+  putch(32);
+  putint(c[n - 1][n - 1]);
+  putch(10);
+  return 0;
+}
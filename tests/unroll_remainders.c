@@ -0,0 +1,42 @@
+int a[64];
+
+// unrolled by the factor, with a remainder loop for the trips left over
+int partial(int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s * 3 + a[i];
+    i = i + 1;
+  }
+  return s;
+}
+
+// counting down by two, to a bound that includes it
+int down(int n) {
+  int s = 0;
+  int i = n;
+  while (i >= 1) {
+    s = s + a[i % 64] * i;
+    i = i - 2;
+  }
+  return s;
+}
+
+int main() {
+  int i = 0;
+  // a constant trip count, unrolled fully
+  while (i < 64) {
+    a[i] = i * 7 % 11 - 5;
+    i = i + 1;
+  }
+  int k = getint();
+  while (k > 0) {
+    int n = getint();
+    putint(partial(n));
+    putch(32);
+    putint(down(n));
+    putch(10);
+    k = k - 1;
+  }
+  return partial(6) % 256;
+}
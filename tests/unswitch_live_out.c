@@ -0,0 +1,52 @@
+int a[100];
+
+int main() {
+  int n = getint();
+  int mode = getint();
+  int i = 0;
+  while (i < n) {
+    a[i] = (i * 37) % 101 - 50;
+    i = i + 1;
+  }
+  // mode does not change in the loop, and s, t and i are used after it
+  int s = 0;
+  int t = 1;
+  i = 0;
+  while (i < n) {
+    if (mode > 1) {
+      s = s + a[i];
+    } else {
+      s = s - a[i] * 2;
+      t = t * 3 % 1000;
+    }
+    if (a[i] > 40) {
+      // a branch that does vary, left in place
+      t = t + 1;
+    }
+    i = i + 1;
+  }
+  // invariant in both loops of a nest, the test moves in front of the outer one
+  int u = 0;
+  int k = 0;
+  while (k < 10) {
+    int j = 0;
+    while (j < k) {
+      if (mode == 0) {
+        u = u + j * k;
+      } else {
+        u = u - j;
+      }
+      j = j + 1;
+    }
+    k = k + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(t);
+  putch(32);
+  putint(u);
+  putch(32);
+  putint(i);
+  putch(10);
+  return (s + t) % 256;
+}